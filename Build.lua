@@ -12,4 +12,8 @@ group "Core"
 	include "Game-Core/Build-Core.lua"
 group ""
 
-include "Game-Engine/Build-App.lua"
\ No newline at end of file
+include "Game-Engine/Build-App.lua"
+
+group "Tools"
+	include "Game-Bench/Build-Bench.lua"
+group ""
\ No newline at end of file
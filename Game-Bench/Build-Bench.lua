@@ -0,0 +1,95 @@
+dofile("../Project-Config.lua")
+
+project "Game-Bench"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++latest"
+   targetdir "Binaries/%{cfg.buildcfg}"
+   staticruntime "off"
+   toolset "msc"
+   vectorextensions "AVX2"
+
+   -- engine subsystems are compiled in directly so they can be measured without a window or a device
+   files { "Source/**.h", "Source/**.cpp",
+           "../Game-Engine/Source/engine/src/vk_bvh.cpp",
+           "../Game-Engine/Source/engine/src/vk_culling.cpp",
+           "../Game-Engine/Source/engine/src/vk_sort.cpp",
+           "../Game-Engine/Source/engine/src/vk_scene.cpp",
+           "../Game-Engine/Source/engine/src/vk_render_list.cpp",
+           "../Game-Engine/Source/engine/src/vk_descriptors.cpp",
+           "../Game-Engine/Source/engine/src/vk_deletion.cpp",
+           "../Game-Engine/Source/engine/src/vk_initializers.cpp",
+           "../Game-Engine/Source/engine/src/vk_gltf_geometry.cpp",
+           "../Game-Engine/Source/vkbootstrap/**.cpp" }
+
+   -- models and shaders are loaded relative to the engine directory
+   debugdir "../Game-Engine"
+
+   includedirs
+   {
+      "Source",
+      "../Game-Engine/Source/engine/include",
+      "../Game-Engine/Source/vkbootstrap",
+      "../Game-Core/Source",
+      "%{IncludeDir.GLM}",
+      "%{IncludeDir.Vulkan}",
+      "%{IncludeDir.FMT}",
+      "%{IncludeDir.FastGLTF}",
+      "%{IncludeDir.VMA}"
+   }
+
+   libdirs
+   {
+      "%{LibraryDir.Vulkan}",
+      "%{LibraryDir.FMT}",
+      "%{LibraryDir.FastGLTF}"
+   }
+
+   links
+   {
+      "Game-Core",
+      "%{Library.Vulkan}",
+      "%{Library.FMT}",
+      "%{Library.FastGLTF}",
+      "%{Library.FastGLTF_simdjson}"
+   }
+
+   targetdir ("../Binaries/" .. OutputDir .. "/%{prj.name}")
+   objdir ("../Binaries/Intermediates/" .. OutputDir .. "/%{prj.name}")
+
+   filter "system:windows"
+       systemversion "latest"
+       defines { "WINDOWS" }
+       postbuildcommands
+       {
+         '{COPY} "%{Binaries.FastGLTF_simdjson}" "%{cfg.targetdir}"',
+         '{COPY} "%{Binaries.FastGLTF}" "%{cfg.targetdir}"',
+         '{COPY} "%{Binaries.shadercd}" "%{cfg.targetdir}"',
+         '{COPY} "%{Binaries.shaderc}" "%{cfg.targetdir}"'
+       }
+
+   filter "configurations:Debug"
+       defines { "DEBUG" }
+       runtime "Debug"
+       symbols "On"
+       links {
+          "%{Library.shadercd}"
+       }
+
+   filter "configurations:Release"
+       defines { "RELEASE" }
+       runtime "Release"
+       optimize "On"
+       symbols "On"
+       links {
+          "%{Library.shaderc}"
+       }
+
+   filter "configurations:Dist"
+       defines { "DIST" }
+       runtime "Release"
+       optimize "On"
+       symbols "Off"
+       links {
+          "%{Library.shaderc}"
+       }
@@ -0,0 +1,29 @@
+#include "bench.h"
+#include <cstring>
+#include <fmt/core.h>
+
+// Game-Bench [group...] runs the named groups, or all of them without arguments
+int main(int argc, char* argv[]) {
+	int ran = 0;
+	for (const bench::Group& group : bench::groups()) {
+		bool selected = argc < 2;
+		for (int i = 1; i < argc; i++) {
+			selected |= std::strcmp(argv[i], group.name) == 0;
+		}
+		if (!selected) {
+			continue;
+		}
+		fmt::print("{}\n", group.name);
+		group.function();
+		ran++;
+	}
+
+	if (ran == 0) {
+		fmt::print("no benchmark group matched, available groups:\n");
+		for (const bench::Group& group : bench::groups()) {
+			fmt::print("  {}\n", group.name);
+		}
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
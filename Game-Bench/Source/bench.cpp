@@ -0,0 +1,66 @@
+#include "bench.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fmt/core.h>
+
+bench::Result bench::run(const std::string& name, size_t iterations, const std::function<void()>& function, size_t samples, size_t warmup) {
+	for (size_t s = 0; s < warmup; s++) {
+		for (size_t i = 0; i < iterations; i++) {
+			function();
+		}
+	}
+
+	std::vector<double> times(samples);
+	for (size_t s = 0; s < samples; s++) {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < iterations; i++) {
+			function();
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		times[s] = std::chrono::duration<double, std::micro>(end - start).count() / double(iterations);
+	}
+
+	Result result{ name, iterations, samples };
+	double sum = 0.0;
+	for (double t : times) {
+		sum += t;
+	}
+	result.mean = sum / double(samples);
+	double variance = 0.0;
+	for (double t : times) {
+		variance += (t - result.mean) * (t - result.mean);
+	}
+	result.stddev = std::sqrt(variance / double(std::max<size_t>(samples - 1, 1)));
+
+	std::sort(times.begin(), times.end());
+	result.min = times.front();
+	result.median = samples % 2 ? times[samples / 2] : 0.5 * (times[samples / 2 - 1] + times[samples / 2]);
+	return result;
+}
+
+void bench::print(const Result& result) {
+	fmt::print("  {:<44} median {:>10.3f} us  min {:>10.3f} us  mean {:>10.3f} us  +- {:>5.1f}%  ({} x {})\n",
+		result.name, result.median, result.min, result.mean, result.mean > 0.0 ? 100.0 * result.stddev / result.mean : 0.0,
+		result.samples, result.iterations);
+}
+
+void bench::compare(const Result& baseline, const Result& candidate) {
+	print(baseline);
+	print(candidate);
+	fmt::print("  {:<44} {:.2f}x\n", "speedup", candidate.median > 0.0 ? baseline.median / candidate.median : 0.0);
+}
+
+void bench::keep(const void* value) {
+	static const void* volatile sink;
+	sink = value;
+}
+
+std::vector<bench::Group>& bench::groups() {
+	static std::vector<Group> registered;
+	return registered;
+}
+
+bench::Registrar::Registrar(const char* name, GroupFunction function) {
+	groups().push_back(Group{ name, function });
+}
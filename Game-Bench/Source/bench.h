@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+	struct Result {
+		std::string name;
+		size_t iterations;   // calls timed together in one sample
+		size_t samples;
+		double median;       // per call, in microseconds
+		double min;
+		double mean;
+		double stddev;
+	};
+
+	// Calls function iterations times per sample, after warmup untimed samples. Per call times of the samples are
+	// reduced to median/min/mean/stddev, the median is the number to compare between runs.
+	Result run(const std::string& name, size_t iterations, const std::function<void()>& function, size_t samples = 15, size_t warmup = 3);
+
+	void print(const Result& result);
+	// ratio of the medians, with both results printed
+	void compare(const Result& baseline, const Result& candidate);
+
+	// keeps the compiler from discarding a computed value
+	void keep(const void* value);
+
+	// benchmark groups register themselves and are run by name from main
+	using GroupFunction = void(*)();
+	struct Registrar {
+		Registrar(const char* name, GroupFunction function);
+	};
+	struct Group {
+		const char* name;
+		GroupFunction function;
+	};
+	std::vector<Group>& groups();
+
+	// fixed seed shared by every group so inputs are identical between runs
+	constexpr uint32_t SEED = 0x5eed1234;
+}
+
+#define BENCH_GROUP(name) \
+	static void bench_group_##name(); \
+	static bench::Registrar bench_registrar_##name(#name, bench_group_##name); \
+	static void bench_group_##name()
@@ -0,0 +1,116 @@
+#include "bench.h"
+#include <vk_bvh.h>
+#include <vk_culling.h>
+#include <Core/ThreadPool.h>
+#include <fmt/core.h>
+#include <random>
+#include <glm/gtx/transform.hpp>
+
+namespace {
+	struct Scene {
+		std::vector<Bounds> bounds;
+		std::vector<glm::mat4> transforms;
+		glm::mat4 viewproj;
+	};
+
+	// objects scattered around the camera so roughly a third of them survive, like a streamed open world
+	Scene make_scene(size_t count) {
+		std::mt19937 rng(bench::SEED);
+		std::uniform_real_distribution<float> position(-2000.f, 2000.f);
+		std::uniform_real_distribution<float> height(-20.f, 200.f);
+		std::uniform_real_distribution<float> extent(0.5f, 8.f);
+		std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+
+		Scene scene;
+		scene.bounds.resize(count);
+		scene.transforms.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			Bounds& b = scene.bounds[i];
+			b.origin = glm::vec3(0.f);
+			b.extents = glm::vec3(extent(rng), extent(rng), extent(rng));
+			b.sphereRadius = glm::length(b.extents);
+			scene.transforms[i] = glm::translate(glm::vec3(position(rng), height(rng), position(rng))) * glm::rotate(angle(rng), glm::vec3(0.f, 1.f, 0.f));
+		}
+
+		// same projection as the engine, reversed depth with the far plane at 10000
+		glm::mat4 projection = glm::perspective(glm::radians(70.f), 1700.f / 900.f, 10000.f, 0.1f);
+		projection[1][1] *= -1;
+		scene.viewproj = projection * glm::lookAt(glm::vec3(0.f, 50.f, 0.f), glm::vec3(100.f, 40.f, 100.f), glm::vec3(0.f, 1.f, 0.f));
+		return scene;
+	}
+}
+
+BENCH_GROUP(culling) {
+	Core::ThreadPool pool;
+	fmt::print("  worker threads: {}\n", pool.GetThreadCount());
+
+	for (size_t count : { 1000u, 10000u, 100000u, 250000u }) {
+		Scene scene = make_scene(count);
+
+		std::vector<uint32_t> visible;
+		visible.reserve(count);
+
+		glm::vec4 planes[6];
+		culling::extract_planes(scene.viewproj, planes);
+
+		culling::BoundsSoA soa;
+		soa.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			soa.set(i, scene.bounds[i], scene.transforms[i]);
+		}
+
+		const size_t iterations = std::max<size_t>(1, 200000 / count);
+
+		bench::Result projected = bench::run(fmt::format("isVisible x{}", count), iterations, [&]() {
+			visible.clear();
+			for (size_t i = 0; i < count; i++) {
+				if (culling::is_visible(scene.bounds[i], scene.transforms[i], scene.viewproj)) {
+					visible.push_back((uint32_t)i);
+				}
+			}
+			bench::keep(visible.data());
+			});
+		const size_t projectedVisible = visible.size();
+
+		bench::Result batched = bench::run(fmt::format("soa cull x{}", count), iterations, [&]() {
+			visible.clear();
+			culling::cull(soa, planes, visible);
+			bench::keep(visible.data());
+			});
+
+		bench::Result threaded = bench::run(fmt::format("soa cull threaded x{}", count), iterations, [&]() {
+			visible.clear();
+			culling::cull(soa, planes, visible, &pool);
+			bench::keep(visible.data());
+			});
+
+		BVH bvh;
+		bench::Result bvhBuild = bench::run(fmt::format("bvh build x{}", count), std::max<size_t>(1, iterations / 10), [&]() {
+			bvh.build(soa);
+			bench::keep(&bvh);
+			});
+
+		bench::Result hierarchical = bench::run(fmt::format("bvh cull x{}", count), iterations, [&]() {
+			visible.clear();
+			bvh.cull(planes, visible);
+			bench::keep(visible.data());
+			});
+
+		// the render list refills the SoA only for objects that moved, this is the cost when all of them did
+		bench::Result build = bench::run(fmt::format("soa build x{}", count), iterations, [&]() {
+			soa.resize(count);
+			for (size_t i = 0; i < count; i++) {
+				soa.set(i, scene.bounds[i], scene.transforms[i]);
+			}
+			bench::keep(soa.centerX.data());
+			});
+
+		bench::compare(projected, batched);
+		bench::print(threaded);
+		bench::compare(batched, hierarchical);
+		bench::print(bvhBuild);
+		bench::print(build);
+		// isVisible also keeps boxes that cross the camera plane, the projected corners flip behind it
+		fmt::print("  visible {} / {} (isVisible {})\n\n", visible.size(), count, projectedVisible);
+	}
+}
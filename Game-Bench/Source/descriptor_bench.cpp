@@ -0,0 +1,129 @@
+#define VMA_IMPLEMENTATION
+#include "bench.h"
+#include <vk_descriptors.h>
+#include <vk_initializers.h>
+#include <VkBootstrap.h>
+#include <fmt/core.h>
+
+namespace {
+	// a device without a window or swapchain, enough to create pools, layouts and the resources sets point at
+	struct HeadlessDevice {
+		vkb::Instance instance;
+		vkb::Device device;
+		VmaAllocator allocator{ VK_NULL_HANDLE };
+
+		bool init() {
+			auto instanceResult = vkb::InstanceBuilder{}.set_app_name("Game-Bench").require_api_version(1, 3, 0).set_headless(true).build();
+			if (!instanceResult) {
+				return false;
+			}
+			instance = instanceResult.value();
+			auto physicalDevice = vkb::PhysicalDeviceSelector{ instance }.set_minimum_version(1, 3).select();
+			if (!physicalDevice) {
+				vkb::destroy_instance(instance);
+				return false;
+			}
+			device = vkb::DeviceBuilder{ physicalDevice.value() }.build().value();
+
+			VmaAllocatorCreateInfo allocatorInfo = {};
+			allocatorInfo.physicalDevice = device.physical_device;
+			allocatorInfo.device = device.device;
+			allocatorInfo.instance = instance.instance;
+			vmaCreateAllocator(&allocatorInfo, &allocator);
+			return true;
+		}
+
+		void destroy() {
+			vmaDestroyAllocator(allocator);
+			vkb::destroy_device(device);
+			vkb::destroy_instance(instance);
+		}
+	};
+}
+
+BENCH_GROUP(descriptors) {
+	HeadlessDevice hd;
+	if (!hd.init()) {
+		fmt::print("  skipped, no Vulkan 1.3 device\n\n");
+		return;
+	}
+	VkDevice device = hd.device.device;
+
+	// the material layout and the per frame pool ratios of the engine
+	DescriptorLayoutBuilder layoutBuilder;
+	layoutBuilder.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+	layoutBuilder.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	layoutBuilder.addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	VkDescriptorSetLayout layout = layoutBuilder.build(device, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+
+	std::vector<DynamicDescriptorAllocator::PoolSizeRatio> sizes = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+	};
+
+	VkBufferCreateInfo bufferInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	bufferInfo.size = 256;
+	bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	VmaAllocationCreateInfo allocInfo = {};
+	allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+	VkBuffer buffer;
+	VmaAllocation bufferAllocation;
+	VK_CHECK(vmaCreateBuffer(hd.allocator, &bufferInfo, &allocInfo, &buffer, &bufferAllocation, nullptr));
+
+	VkImageCreateInfo imageInfo = vkinit::image_create_info(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, VkExtent3D{ 4, 4, 1 });
+	VkImage image;
+	VmaAllocation imageAllocation;
+	VK_CHECK(vmaCreateImage(hd.allocator, &imageInfo, &allocInfo, &image, &imageAllocation, nullptr));
+	VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(VK_FORMAT_R8G8B8A8_UNORM, image, VK_IMAGE_ASPECT_COLOR_BIT);
+	VkImageView view;
+	VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &view));
+	VkSamplerCreateInfo samplerInfo = { .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+	VkSampler sampler;
+	VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &sampler));
+
+	for (uint32_t count : { 100u, 1000u }) {
+		DynamicDescriptorAllocator allocator;
+		allocator.init(device, 128, sizes);
+		std::vector<VkDescriptorSet> sets(count);
+
+		// a frame's worth of allocations and the reset at the start of the next frame
+		bench::Result allocate = bench::run(fmt::format("allocate + clearPools x{}", count), 10, [&]() {
+			for (uint32_t i = 0; i < count; i++) {
+				sets[i] = allocator.allocate(device, layout);
+			}
+			allocator.clearPools(device);
+			bench::keep(sets.data());
+			});
+
+		for (uint32_t i = 0; i < count; i++) {
+			sets[i] = allocator.allocate(device, layout);
+		}
+
+		// what writeMaterial does per material
+		DescriptorWriter writer;
+		bench::Result write = bench::run(fmt::format("DescriptorWriter updateSet x{}", count), 10, [&]() {
+			for (uint32_t i = 0; i < count; i++) {
+				writer.clear();
+				writer.writeBuffer(0, buffer, bufferInfo.size, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+				writer.writeImage(1, view, sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+				writer.writeImage(2, view, sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+				writer.updateSet(device, sets[i]);
+			}
+			bench::keep(sets.data());
+			});
+
+		bench::print(allocate);
+		bench::print(write);
+		fmt::print("\n");
+		allocator.destroyPools(device);
+	}
+
+	vkDestroySampler(device, sampler, nullptr);
+	vkDestroyImageView(device, view, nullptr);
+	vmaDestroyImage(hd.allocator, image, imageAllocation);
+	vmaDestroyBuffer(hd.allocator, buffer, bufferAllocation);
+	vkDestroyDescriptorSetLayout(device, layout, nullptr);
+	hd.destroy();
+}
@@ -0,0 +1,43 @@
+#include "bench.h"
+#include <vk_gltf_geometry.h>
+#include <fmt/core.h>
+#include <fastgltf/parser.hpp>
+
+namespace {
+	// relative to the engine directory, which the project sets as the working directory
+	const std::filesystem::path MODEL_PATH = "Source/models/basicmesh.glb";
+}
+
+BENCH_GROUP(gltf) {
+	fastgltf::GltfDataBuffer data;
+	if (!data.loadFromFile(MODEL_PATH)) {
+		fmt::print("  skipped, could not read {}\n\n", MODEL_PATH.string());
+		return;
+	}
+
+	// parsing is done once, only the vertex assembly the loader runs per primitive is timed
+	fastgltf::Parser parser{};
+	auto load = parser.loadBinaryGLTF(&data, MODEL_PATH.parent_path(), fastgltf::Options::LoadGLBBuffers);
+	if (!load) {
+		fmt::print("  skipped, could not parse {}\n\n", MODEL_PATH.string());
+		return;
+	}
+	fastgltf::Asset gltf = std::move(load.get());
+
+	std::vector<uint32_t> indices;
+	std::vector<Vertex> vertices;
+	bench::Result assembly = bench::run(fmt::format("append_primitive {} meshes", gltf.meshes.size()), 20, [&]() {
+		for (fastgltf::Mesh& mesh : gltf.meshes) {
+			indices.clear();
+			vertices.clear();
+			for (fastgltf::Primitive& p : mesh.primitives) {
+				Bounds bounds = gltf_geometry::append_primitive(gltf, p, indices, vertices);
+				bench::keep(&bounds);
+			}
+			bench::keep(vertices.data());
+		}
+		});
+
+	bench::print(assembly);
+	fmt::print("  {} vertices, {} indices in the last mesh\n\n", vertices.size(), indices.size());
+}
@@ -0,0 +1,38 @@
+#include "bench.h"
+#include <vk_shaderc_compiler.hpp>
+#include <fmt/core.h>
+
+namespace {
+	// relative to the engine directory, which the project sets as the working directory
+	const shdc::fs::path SHADER_ROOT = "Source/shaders/glsl";
+}
+
+BENCH_GROUP(shaders) {
+	if (!shdc::fs::is_directory(SHADER_ROOT)) {
+		fmt::print("  skipped, {} not found\n\n", SHADER_ROOT.string());
+		return;
+	}
+
+	// include.glsl and the other .glsl files are only pulled in by includes
+	std::vector<shdc::fs::path> shaders;
+	for (const auto& entry : shdc::fs::directory_iterator(SHADER_ROOT)) {
+		if (entry.is_regular_file() && entry.path().extension() != ".glsl") {
+			shaders.push_back(entry.path().filename());
+		}
+	}
+	std::sort(shaders.begin(), shaders.end());
+
+	// compilation takes milliseconds, so fewer samples keep the group short
+	std::vector<bench::Result> results;
+	for (const shdc::fs::path& shader : shaders) {
+		results.push_back(bench::run(fmt::format("compile {}", shader.string()), 1, [&]() {
+			std::vector<uint32_t> spirv = shdc::compileGLSLtoSPV(shader, SHADER_ROOT);
+			bench::keep(spirv.data());
+			}, 7, 1));
+	}
+
+	for (const bench::Result& result : results) {
+		bench::print(result);
+	}
+	fmt::print("\n");
+}
@@ -0,0 +1,133 @@
+#include "bench.h"
+#include <vk_sort.h>
+#include <fmt/core.h>
+#include <memory>
+#include <random>
+
+namespace {
+	// the fields drawMesh compared before the packed keys, laid out like RenderObject so the comparator
+	// chases the same pointers
+	struct Material {
+		uint32_t sortId;
+		uint32_t pipelineId;
+		char descriptorState[56];
+	};
+
+	struct Lod {
+		uint32_t startIndex;
+		uint32_t count;
+	};
+
+	struct DrawObject {
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		uint64_t indexBuffer;
+		uint32_t indexType;
+		uint32_t baseIndex;
+		uint32_t geometryId;
+		Material* material;
+		glm::mat4 transform;
+		glm::vec3 center;
+		const Lod* lod;
+	};
+
+	struct Scene {
+		std::vector<std::unique_ptr<Material>> materials;
+		std::vector<Lod> lods;
+		std::vector<DrawObject> objects;
+		glm::mat4 view;
+	};
+
+	Scene make_scene(size_t count) {
+		std::mt19937 rng(bench::SEED);
+		std::uniform_real_distribution<float> position(-500.f, 500.f);
+
+		Scene scene;
+		// materials allocated one by one like the loader does, so their addresses carry no useful order
+		for (uint32_t m = 0; m < 300; m++) {
+			scene.materials.push_back(std::make_unique<Material>(Material{ m, m % 7 == 0 ? 1u : 0u }));
+		}
+		for (uint32_t g = 0; g < 2000; g++) {
+			scene.lods.push_back(Lod{ g * 900, 900 });
+		}
+
+		std::uniform_int_distribution<uint32_t> material(0, (uint32_t)scene.materials.size() - 1);
+		std::uniform_int_distribution<uint32_t> geometry(0, (uint32_t)scene.lods.size() - 1);
+		scene.objects.resize(count);
+		for (DrawObject& o : scene.objects) {
+			uint32_t g = geometry(rng);
+			o.material = scene.materials[material(rng)].get();
+			o.indexBuffer = 0x1000 + (g / 500) * 0x100;
+			o.indexType = g % 3 == 0 ? 1 : 0;
+			o.baseIndex = 0;
+			o.geometryId = g;
+			o.lod = &scene.lods[g];
+			o.center = glm::vec3(position(rng), position(rng), position(rng));
+		}
+		scene.view = glm::mat4(1.f);
+		scene.view[3] = glm::vec4(0.f, 0.f, -600.f, 1.f);
+		return scene;
+	}
+}
+
+BENCH_GROUP(draw_sort) {
+	for (size_t count : { 5000u, 50000u }) {
+		Scene scene = make_scene(count);
+
+		std::vector<uint32_t> draws(count);
+		const size_t iterations = std::max<size_t>(1, 100000 / count);
+
+		// the pre-key comparator, sorting a fresh index list every frame
+		bench::Result comparator = bench::run(fmt::format("std::sort comparator x{}", count), iterations, [&]() {
+			for (uint32_t i = 0; i < count; i++) {
+				draws[i] = i;
+			}
+			std::sort(draws.begin(), draws.end(), [&](const auto& iA, const auto& iB) {
+				const DrawObject& A = scene.objects[iA];
+				const DrawObject& B = scene.objects[iB];
+				if (A.material == B.material) {
+					if (A.indexBuffer == B.indexBuffer) {
+						if (A.indexType == B.indexType) {
+							return A.baseIndex + A.lod->startIndex < B.baseIndex + B.lod->startIndex;
+						}
+						return A.indexType < B.indexType;
+					}
+					return A.indexBuffer < B.indexBuffer;
+				}
+				else {
+					return A.material < B.material;
+				}
+				});
+			bench::keep(draws.data());
+			});
+
+		std::vector<drawsort::Item> items;
+		std::vector<drawsort::Item> scratch;
+		// key building included, it is part of the per frame cost
+		bench::Result radix = bench::run(fmt::format("packed keys + radix x{}", count), iterations, [&]() {
+			items.clear();
+			for (uint32_t i = 0; i < count; i++) {
+				const DrawObject& o = scene.objects[i];
+				float depth = -(scene.view * glm::vec4(o.center, 1.f)).z;
+				items.push_back({ drawsort::make_key(0, o.material->pipelineId, o.material->sortId, o.indexType, o.geometryId << 2, depth), i });
+			}
+			drawsort::radix_sort(items, scratch);
+			bench::keep(items.data());
+			});
+
+		bench::Result keysOnly = bench::run(fmt::format("packed keys + std::sort x{}", count), iterations, [&]() {
+			items.clear();
+			for (uint32_t i = 0; i < count; i++) {
+				const DrawObject& o = scene.objects[i];
+				float depth = -(scene.view * glm::vec4(o.center, 1.f)).z;
+				items.push_back({ drawsort::make_key(0, o.material->pipelineId, o.material->sortId, o.indexType, o.geometryId << 2, depth), i });
+			}
+			std::sort(items.begin(), items.end(), [](const drawsort::Item& a, const drawsort::Item& b) { return a.key < b.key; });
+			bench::keep(items.data());
+			});
+
+		bench::compare(comparator, radix);
+		bench::print(keysOnly);
+		fmt::print("\n");
+	}
+}
@@ -0,0 +1,90 @@
+#include "bench.h"
+#include <vk_scene.h>
+#include <Core/ThreadPool.h>
+#include <fmt/core.h>
+#include <random>
+#include <glm/gtx/transform.hpp>
+
+namespace {
+	struct Hierarchy {
+		std::vector<std::shared_ptr<Node>> roots;
+		SceneGraph graph;
+		size_t count{ 0 };
+	};
+
+	// the same random transforms as a pointer tree and as a scene graph, fanout children per node down to depth
+	Hierarchy make_hierarchy(uint32_t fanout, uint32_t depth) {
+		std::mt19937 rng(bench::SEED);
+		std::uniform_real_distribution<float> offset(-10.f, 10.f);
+		std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+		auto randomTransform = [&]() {
+			return glm::translate(glm::vec3(offset(rng), offset(rng), offset(rng))) * glm::rotate(angle(rng), glm::vec3(0.f, 1.f, 0.f));
+		};
+
+		Hierarchy h;
+		std::shared_ptr<Node> root = std::make_shared<Node>();
+		root->localTransform = randomTransform();
+		h.roots.push_back(root);
+
+		// breadth first, as the graph requires
+		std::vector<std::pair<std::shared_ptr<Node>, uint32_t>> level{ { root, h.graph.addNode(SceneGraph::NO_PARENT, root->localTransform) } };
+		for (uint32_t d = 1; d < depth; d++) {
+			std::vector<std::pair<std::shared_ptr<Node>, uint32_t>> next;
+			for (auto& [parent, parentIndex] : level) {
+				for (uint32_t c = 0; c < fanout; c++) {
+					std::shared_ptr<Node> child = std::make_shared<Node>();
+					child->localTransform = randomTransform();
+					child->parent = parent;
+					parent->children.push_back(child);
+					next.push_back({ child, h.graph.addNode(parentIndex, child->localTransform) });
+				}
+			}
+			level = std::move(next);
+		}
+		h.count = h.graph.size();
+		return h;
+	}
+}
+
+BENCH_GROUP(transforms) {
+	Core::ThreadPool pool;
+
+	for (uint32_t depth : { 4u, 6u }) {
+		Hierarchy h = make_hierarchy(8, depth);
+		const size_t iterations = std::max<size_t>(1, 400000 / h.count);
+		const glm::mat4 rootTransform = h.roots[0]->localTransform;
+		const glm::mat4 childTransform = h.roots[0]->children[0]->localTransform;
+
+		bench::Result tree = bench::run(fmt::format("Node::refreshTransform x{}", h.count), iterations, [&]() {
+			for (auto& root : h.roots) {
+				root->refreshTransform(glm::mat4{ 1.f });
+			}
+			bench::keep(&h.roots[0]->worldTransform);
+			});
+
+		// a moved root dirties every node, the same work refreshTransform always does
+		bench::Result graph = bench::run(fmt::format("SceneGraph all dirty x{}", h.count), iterations, [&]() {
+			h.graph.setLocalTransform(0, rootTransform);
+			h.graph.updateTransforms();
+			bench::keep(&h.graph.worldTransform(0));
+			});
+
+		bench::Result threaded = bench::run(fmt::format("SceneGraph all dirty threaded x{}", h.count), iterations, [&]() {
+			h.graph.setLocalTransform(0, rootTransform);
+			h.graph.updateTransforms(&pool);
+			bench::keep(&h.graph.worldTransform(0));
+			});
+
+		// one moved child of the root, the graph walks every level but only multiplies an eighth of the nodes
+		bench::Result partial = bench::run(fmt::format("SceneGraph one subtree dirty x{}", h.count), iterations, [&]() {
+			h.graph.setLocalTransform(1, childTransform);
+			h.graph.updateTransforms();
+			bench::keep(&h.graph.worldTransform(1));
+			});
+
+		bench::compare(tree, graph);
+		bench::print(threaded);
+		bench::print(partial);
+		fmt::print("\n");
+	}
+}
@@ -0,0 +1,51 @@
+#include "FrameArena.h"
+#include <algorithm>
+
+namespace Core {
+
+	FrameArena::FrameArena(size_t initialSize)
+	{
+		AddBlock(std::max<size_t>(initialSize, 1));
+	}
+
+	void* FrameArena::Allocate(size_t size, size_t alignment)
+	{
+		Block* block = &m_Blocks.back();
+		uintptr_t base = reinterpret_cast<uintptr_t>(block->Data.get());
+		size_t offset = ((base + m_Offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+
+		if (offset + size > block->Size)
+		{
+			// the next block at least doubles, so a frame needs few of them before the blocks are merged
+			AddBlock(std::max(block->Size * 2, size + alignment));
+			block = &m_Blocks.back();
+			base = reinterpret_cast<uintptr_t>(block->Data.get());
+			offset = ((base + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+		}
+
+		m_Offset = offset + size;
+		m_Used += size;
+		return block->Data.get() + offset;
+	}
+
+	void FrameArena::Reset()
+	{
+		if (m_Blocks.size() > 1)
+		{
+			size_t total = m_Capacity;
+			m_Blocks.clear();
+			m_Capacity = 0;
+			AddBlock(total);
+		}
+		m_Offset = 0;
+		m_Used = 0;
+	}
+
+	void FrameArena::AddBlock(size_t size)
+	{
+		m_Blocks.push_back(Block{ std::unique_ptr<std::byte[]>(new std::byte[size]), size });
+		m_Capacity += size;
+		m_Offset = 0;
+	}
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Core {
+
+	// Bump allocator for data that lives for one frame. Allocating moves an offset and nothing is freed on its own,
+	// Reset releases everything at once. The memory is kept: a frame that overflowed the first block gets one block
+	// large enough for all of it on the next Reset, so a steady frame never reaches the heap.
+	// Not thread safe, every frame in flight or thread owns its own arena.
+	class FrameArena
+	{
+	public:
+		explicit FrameArena(size_t initialSize = 64 * 1024);
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		void* Allocate(size_t size, size_t alignment);
+		template<typename T>
+		T* Allocate(size_t count) { return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T))); }
+
+		// everything allocated since the last reset becomes invalid
+		void Reset();
+
+		size_t GetUsed() const { return m_Used; }
+		size_t GetCapacity() const { return m_Capacity; }
+
+	private:
+		struct Block {
+			std::unique_ptr<std::byte[]> Data;
+			size_t Size;
+		};
+
+		void AddBlock(size_t size);
+
+		std::vector<Block> m_Blocks;
+		// into the last block
+		size_t m_Offset = 0;
+		size_t m_Used = 0;
+		size_t m_Capacity = 0;
+	};
+
+	// Standard allocator on top of a FrameArena, deallocation is a no-op. Without an arena it falls back to the heap,
+	// so types holding one can also be used outside the frame.
+	template<typename T>
+	class ArenaAllocator
+	{
+	public:
+		using value_type = T;
+
+		ArenaAllocator(FrameArena* arena = nullptr) noexcept : m_Arena(arena) {}
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_Arena(other.GetArena()) {}
+
+		T* allocate(size_t count)
+		{
+			return m_Arena ? m_Arena->Allocate<T>(count) : std::allocator<T>().allocate(count);
+		}
+
+		void deallocate(T* pointer, size_t count) noexcept
+		{
+			if (!m_Arena)
+			{
+				std::allocator<T>().deallocate(pointer, count);
+			}
+		}
+
+		FrameArena* GetArena() const { return m_Arena; }
+
+		template<typename U>
+		bool operator==(const ArenaAllocator<U>& other) const { return m_Arena == other.GetArena(); }
+
+	private:
+		FrameArena* m_Arena;
+	};
+
+	template<typename T>
+	using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}
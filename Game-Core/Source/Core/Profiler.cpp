@@ -0,0 +1,153 @@
+#include "Profiler.h"
+
+#if CORE_PROFILING
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Core {
+
+	namespace {
+
+		// fields are atomic so the exporter may read a ring while its thread keeps writing
+		struct Zone {
+			std::atomic<const char*> Name{ nullptr };
+			std::atomic<int64_t> Start{ 0 };
+			std::atomic<int64_t> End{ 0 };
+		};
+
+		struct ThreadRing {
+			std::array<Zone, Profiler::RING_SIZE> Zones;
+			std::atomic<uint64_t> Head{ 0 };
+			uint32_t Id = 0;
+			std::string Name;
+		};
+
+		struct Registry {
+			std::mutex Mutex;
+			std::vector<std::unique_ptr<ThreadRing>> Rings;
+			const std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+		};
+
+		// never destroyed, threads may still record while static destructors run
+		Registry& GetRegistry()
+		{
+			static Registry* registry = new Registry();
+			return *registry;
+		}
+
+		thread_local ThreadRing* t_Ring = nullptr;
+
+		ThreadRing& GetRing()
+		{
+			if (t_Ring == nullptr)
+			{
+				Registry& registry = GetRegistry();
+				std::lock_guard lock(registry.Mutex);
+				auto ring = std::make_unique<ThreadRing>();
+				ring->Id = (uint32_t)registry.Rings.size();
+				ring->Name = "thread " + std::to_string(ring->Id);
+				t_Ring = ring.get();
+				registry.Rings.push_back(std::move(ring));
+			}
+			return *t_Ring;
+		}
+
+		void WriteEscaped(std::ofstream& out, const char* text)
+		{
+			for (; *text != '\0'; text++)
+			{
+				if (*text == '"' || *text == '\\')
+				{
+					out << '\\';
+				}
+				out << *text;
+			}
+		}
+
+	}
+
+	int64_t Profiler::Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - GetRegistry().Epoch).count();
+	}
+
+	void Profiler::Record(const char* name, int64_t start, int64_t end)
+	{
+		ThreadRing& ring = GetRing();
+		const uint64_t head = ring.Head.load(std::memory_order_relaxed);
+		Zone& zone = ring.Zones[head & (RING_SIZE - 1)];
+		zone.Name.store(name, std::memory_order_relaxed);
+		zone.Start.store(start, std::memory_order_relaxed);
+		zone.End.store(end, std::memory_order_relaxed);
+		ring.Head.store(head + 1, std::memory_order_release);
+	}
+
+	void Profiler::SetThreadName(const std::string& name)
+	{
+		ThreadRing& ring = GetRing();
+		std::lock_guard lock(GetRegistry().Mutex);
+		ring.Name = name;
+	}
+
+	bool Profiler::WriteChromeTrace(const std::string& path)
+	{
+		std::ofstream out(path, std::ios::trunc);
+		if (!out)
+		{
+			return false;
+		}
+
+		Registry& registry = GetRegistry();
+		std::lock_guard lock(registry.Mutex);
+
+		struct Copy {
+			const char* Name;
+			int64_t Start;
+			int64_t End;
+		};
+		std::vector<Copy> zones;
+		char number[64];
+		bool first = true;
+
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		for (const std::unique_ptr<ThreadRing>& ring : registry.Rings)
+		{
+			out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->Id << ",\"args\":{\"name\":\"";
+			WriteEscaped(out, ring->Name.c_str());
+			out << "\"}}";
+			first = false;
+
+			const uint64_t head = ring->Head.load(std::memory_order_acquire);
+			const uint64_t begin = head > RING_SIZE ? head - RING_SIZE : 0;
+			zones.clear();
+			for (uint64_t i = begin; i < head; i++)
+			{
+				const Zone& zone = ring->Zones[i & (RING_SIZE - 1)];
+				zones.push_back({ zone.Name.load(std::memory_order_relaxed), zone.Start.load(std::memory_order_relaxed), zone.End.load(std::memory_order_relaxed) });
+			}
+
+			// zones the owning thread overwrote while they were copied are dropped
+			const uint64_t after = ring->Head.load(std::memory_order_acquire);
+			const uint64_t valid = after + 1 > RING_SIZE ? after + 1 - RING_SIZE : 0;
+			for (uint64_t i = std::max(begin, valid); i < head; i++)
+			{
+				const Copy& zone = zones[i - begin];
+				out << ",\n{\"name\":\"";
+				WriteEscaped(out, zone.Name);
+				std::snprintf(number, sizeof(number), "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f", zone.Start / 1000.0, (zone.End - zone.Start) / 1000.0);
+				out << number << ",\"pid\":1,\"tid\":" << ring->Id << "}";
+			}
+		}
+		out << "\n]}\n";
+		return (bool)out;
+	}
+
+}
+#endif
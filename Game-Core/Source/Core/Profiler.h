@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Zones are compiled out of Dist builds, the macros below expand to nothing there
+#if !defined(DIST)
+#define CORE_PROFILING 1
+#else
+#define CORE_PROFILING 0
+#endif
+
+namespace Core {
+
+#if CORE_PROFILING
+	// Scoped CPU zones recorded into a ring buffer per thread. Only the owning thread writes its ring, so recording is
+	// two clock reads and a few relaxed stores. Full rings overwrite their oldest zones. Zone names must outlive
+	// the profiler, string literals and __FUNCTION__ do.
+	class Profiler {
+	public:
+		// zones kept per thread
+		static constexpr uint32_t RING_SIZE = 1 << 16;
+
+		// nanoseconds on the steady clock since the profiler started
+		static int64_t Now();
+		static void Record(const char* name, int64_t start, int64_t end);
+		// names the calling thread in the trace
+		static void SetThreadName(const std::string& name);
+
+		// writes every zone still held by the rings as Chrome trace JSON, readable by chrome://tracing and Perfetto
+		static bool WriteChromeTrace(const std::string& path);
+	};
+
+	class ProfileScope {
+	public:
+		explicit ProfileScope(const char* name) : m_Name(name), m_Start(Profiler::Now()) {}
+		~ProfileScope() { Profiler::Record(m_Name, m_Start, Profiler::Now()); }
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+		const char* m_Name;
+		int64_t m_Start;
+	};
+#endif
+
+}
+
+#if CORE_PROFILING
+#define CORE_PROFILE_CONCAT_INNER(a, b) a##b
+#define CORE_PROFILE_CONCAT(a, b) CORE_PROFILE_CONCAT_INNER(a, b)
+#define CORE_PROFILE_SCOPE(name) ::Core::ProfileScope CORE_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define CORE_PROFILE_FUNCTION() CORE_PROFILE_SCOPE(__FUNCTION__)
+#define CORE_PROFILE_THREAD(name) ::Core::Profiler::SetThreadName(name)
+#else
+#define CORE_PROFILE_SCOPE(name)
+#define CORE_PROFILE_FUNCTION()
+#define CORE_PROFILE_THREAD(name)
+#endif
@@ -0,0 +1,162 @@
+#pragma once
+#include "ThreadPool.h"
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace Core {
+
+	template<typename T>
+	class Task;
+
+	namespace Detail {
+
+		struct PromiseBase
+		{
+			// a task awaited by another resumes it when done, a top level task just records that it finished
+			struct FinalAwaiter
+			{
+				bool await_ready() const noexcept { return false; }
+
+				template<typename Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+				{
+					PromiseBase& promise = handle.promise();
+					if (promise.Continuation)
+					{
+						return promise.Continuation;
+					}
+					// the owner may destroy the frame as soon as this is set, so nothing touches it afterwards
+					promise.Finished.store(true, std::memory_order_release);
+					return std::noop_coroutine();
+				}
+
+				void await_resume() const noexcept {}
+			};
+
+			std::suspend_always initial_suspend() const noexcept { return {}; }
+			FinalAwaiter final_suspend() const noexcept { return {}; }
+			// loaders report failure through their result, an escaping exception is a bug
+			void unhandled_exception() const noexcept { std::terminate(); }
+
+			std::coroutine_handle<> Continuation;
+			std::atomic<bool> Finished{ false };
+		};
+
+		template<typename T>
+		struct Promise : PromiseBase
+		{
+			Task<T> get_return_object();
+			template<typename U>
+			void return_value(U&& value) { Result.emplace(std::forward<U>(value)); }
+
+			std::optional<T> Result;
+		};
+
+		template<>
+		struct Promise<void> : PromiseBase
+		{
+			Task<void> get_return_object();
+			void return_void() const noexcept {}
+		};
+
+	}
+
+	// Lazily started coroutine. Awaiting a task runs it and resumes the awaiting coroutine on whichever thread the task
+	// finishes on, without going through a scheduler. A top level task is started once with Start and polled with
+	// IsDone by its owner, who keeps it alive until it has finished: destroying a task that is suspended destroys its
+	// frame, destroying one that is running on another thread is undefined.
+	template<typename T = void>
+	class Task
+	{
+	public:
+		using promise_type = Detail::Promise<T>;
+
+		Task() = default;
+		explicit Task(std::coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+		Task(Task&& other) noexcept : m_Handle(std::exchange(other.m_Handle, nullptr)) {}
+		Task& operator=(Task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Reset();
+				m_Handle = std::exchange(other.m_Handle, nullptr);
+			}
+			return *this;
+		}
+		~Task() { Reset(); }
+
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		// runs on the calling thread up to the first suspension
+		void Start() { m_Handle.resume(); }
+		bool IsValid() const { return (bool)m_Handle; }
+		bool IsDone() const { return !m_Handle || m_Handle.promise().Finished.load(std::memory_order_acquire); }
+
+		template<typename U = T> requires (!std::is_void_v<U>)
+		U& GetResult() { return *m_Handle.promise().Result; }
+
+		auto operator co_await() && noexcept
+		{
+			struct Awaiter
+			{
+				std::coroutine_handle<promise_type> Handle;
+
+				bool await_ready() const noexcept { return false; }
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+				{
+					Handle.promise().Continuation = awaiting;
+					return Handle;
+				}
+				T await_resume()
+				{
+					if constexpr (!std::is_void_v<T>)
+					{
+						return std::move(*Handle.promise().Result);
+					}
+				}
+			};
+			return Awaiter{ m_Handle };
+		}
+
+	private:
+		void Reset()
+		{
+			if (m_Handle)
+			{
+				m_Handle.destroy();
+				m_Handle = nullptr;
+			}
+		}
+
+		std::coroutine_handle<promise_type> m_Handle;
+	};
+
+	namespace Detail {
+
+		template<typename T>
+		Task<T> Promise<T>::get_return_object() { return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this)); }
+
+		inline Task<void> Promise<void>::get_return_object() { return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this)); }
+
+	}
+
+	// co_await ResumeOn(pool) continues the coroutine as a job on one of the pool's workers
+	inline auto ResumeOn(ThreadPool& pool)
+	{
+		struct Awaiter
+		{
+			ThreadPool& Pool;
+
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> handle) { Pool.Submit([handle]() { handle.resume(); }); }
+			void await_resume() const noexcept {}
+		};
+		return Awaiter{ pool };
+	}
+
+}
@@ -0,0 +1,114 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <memory>
+
+namespace Core {
+
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		if (threadCount == 0)
+		{
+			threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+
+		m_Workers.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; i++)
+		{
+			m_Workers.emplace_back([this, i]() { WorkerLoop(i); });
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Stopping = true;
+		}
+		m_Wake.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	void ThreadPool::Submit(std::function<void()> job)
+	{
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Jobs.push_back(std::move(job));
+		}
+		m_Wake.notify_one();
+	}
+
+	void ThreadPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& function)
+	{
+		grainSize = std::max<size_t>(grainSize, 1);
+		const size_t rangeCount = (count + grainSize - 1) / grainSize;
+		if (rangeCount <= 1 || m_Workers.empty())
+		{
+			if (count > 0)
+			{
+				function(0, count);
+			}
+			return;
+		}
+
+		// helpers can start after the caller already finished every range, so the state outlives this call
+		struct State {
+			std::atomic<size_t> next{ 0 };
+			std::atomic<size_t> finished{ 0 };
+			std::mutex mutex;
+			std::condition_variable done;
+		};
+		auto state = std::make_shared<State>();
+
+		auto run = [state, count, grainSize, rangeCount, &function]() {
+			size_t range;
+			while ((range = state->next.fetch_add(1)) < rangeCount)
+			{
+				CORE_PROFILE_SCOPE("parallel for range");
+				size_t begin = range * grainSize;
+				function(begin, std::min(begin + grainSize, count));
+				if (state->finished.fetch_add(1) + 1 == rangeCount)
+				{
+					std::lock_guard lock(state->mutex);
+					state->done.notify_all();
+				}
+			}
+		};
+
+		const size_t helpers = std::min<size_t>(m_Workers.size(), rangeCount - 1);
+		for (size_t i = 0; i < helpers; i++)
+		{
+			Submit(run);
+		}
+		run();
+
+		std::unique_lock lock(state->mutex);
+		state->done.wait(lock, [&]() { return state->finished.load() == rangeCount; });
+	}
+
+	void ThreadPool::WorkerLoop(uint32_t index)
+	{
+		CORE_PROFILE_THREAD("worker " + std::to_string(index));
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock lock(m_Mutex);
+				m_Wake.wait(lock, [this]() { return m_Stopping || !m_Jobs.empty(); });
+				if (m_Stopping && m_Jobs.empty())
+				{
+					return;
+				}
+				job = std::move(m_Jobs.front());
+				m_Jobs.pop_front();
+			}
+			CORE_PROFILE_SCOPE("job");
+			job();
+		}
+	}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Core {
+
+	// Fixed set of worker threads fed from a shared job queue.
+	class ThreadPool {
+	public:
+		// 0 picks one worker per hardware thread besides the calling one
+		explicit ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void Submit(std::function<void()> job);
+
+		// Splits [0, count) into ranges of grainSize and runs them on the workers and the calling thread.
+		// Returns once every range has finished.
+		void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& function);
+
+		uint32_t GetThreadCount() const { return (uint32_t)m_Workers.size(); }
+
+	private:
+		void WorkerLoop(uint32_t index);
+
+		std::vector<std::thread> m_Workers;
+		std::deque<std::function<void()>> m_Jobs;
+		std::mutex m_Mutex;
+		std::condition_variable m_Wake;
+		bool m_Stopping = false;
+	};
+
+}
@@ -7,6 +7,7 @@ project "Game-Engine"
    targetdir "Binaries/%{cfg.buildcfg}"
    staticruntime "off"
    toolset "msc"
+   vectorextensions "AVX2"
 
 
    files { "Source/engine/include/**.h", "Source/engine/include/**.hpp", "Source/engine/src/**.cpp", "Source/engine/src/**.c",
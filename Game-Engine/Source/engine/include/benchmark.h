@@ -0,0 +1,63 @@
+#pragma once
+#include <vk_types.h>
+#include <camera.h>
+
+// Camera keyframes, stored as text with one "time x y z pitch yaw" line per keyframe. Poses between keyframes are
+// interpolated linearly.
+class CameraPath {
+public:
+	struct Keyframe {
+		float time;
+		glm::vec3 position;
+		float pitch;
+		float yaw;
+	};
+
+	bool load(const std::string& path);
+	bool save(const std::string& path) const;
+	void clear() { keyframes.clear(); }
+
+	// keyframes are expected in increasing time
+	void add(const Keyframe& keyframe) { keyframes.push_back(keyframe); }
+	Keyframe sample(float time) const;
+	float duration() const { return keyframes.empty() ? 0.f : keyframes.back().time; }
+	bool empty() const { return keyframes.empty(); }
+private:
+	std::vector<Keyframe> keyframes;
+};
+
+// Replays a camera path at a fixed timestep, so every run renders the same poses whatever the frame rate, and
+// reports frame time percentiles. Warmup frames hold the first pose and are not recorded. GPU times arrive
+// gpuLatency frames late, so the last poses are held that long to collect them.
+class CameraBenchmark {
+public:
+	static constexpr uint32_t WARMUP_FRAMES = 16;
+	// frames slower than this many medians count as hitches
+	static constexpr float HITCH_FACTOR = 2.f;
+
+	struct FrameSample {
+		float frameMs;
+		float cpuMs;
+		float gpuMs;
+		int triangles;
+		int draws;
+	};
+
+	bool load(const std::string& path, float timestep, uint32_t gpuLatency);
+	bool active() const { return !path.empty(); }
+
+	// poses the camera for the next frame, false once every frame has been recorded
+	bool beginFrame(Camera& camera);
+	// gpuMs belongs to the frame gpuLatency frames back, NaN when GPU timings are unavailable
+	void endFrame(float frameMs, float cpuMs, float gpuMs, int triangles, int draws);
+
+	// writes one CSV row per frame and a percentile summary next to it with a .txt extension
+	bool writeReport(const std::string& csvPath) const;
+private:
+	CameraPath path;
+	float timestep{ 1.f / 60.f };
+	uint32_t gpuLatency{ 0 };
+	uint32_t recordedFrames{ 0 };
+	uint32_t frame{ 0 };
+	std::vector<FrameSample> samples;
+};
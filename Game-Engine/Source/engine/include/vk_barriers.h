@@ -0,0 +1,59 @@
+#pragma once
+#include <vk_types.h>
+#include <unordered_map>
+
+// how an image is used, the stages and accesses are exactly the ones that use touches
+struct ImageState {
+	VkImageLayout layout;
+	VkPipelineStageFlags2 stages;
+	VkAccessFlags2 access;
+};
+
+namespace imagestate {
+	constexpr ImageState UNDEFINED{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE };
+	constexpr ImageState COMPUTE_STORAGE{ VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT };
+	constexpr ImageState COLOR_ATTACHMENT{ VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT };
+	constexpr ImageState DEPTH_ATTACHMENT{ VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+	constexpr ImageState TRANSFER_SRC{ VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT };
+	constexpr ImageState TRANSFER_DST{ VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT };
+	constexpr ImageState SHADER_READ{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT };
+	// the presentation engine waits on a semaphore, so nothing after the barrier has to wait on it
+	constexpr ImageState PRESENT{ VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE };
+
+	// accesses that have to be made available before another access, reads only need ordering
+	constexpr VkAccessFlags2 WRITE_ACCESS = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		| VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+	// the usual state for an image in the given layout
+	ImageState from_layout(VkImageLayout layout);
+}
+
+// Remembers the last layout, stages and access of every image it has seen. Transitions are queued and written by
+// flush as a single vkCmdPipelineBarrier2, each waiting only on the stages that last used the image. A read after
+// a read in the same layout needs no barrier and is folded into the tracked state instead.
+class BarrierTracker {
+public:
+	// sets the state of an image without a barrier, for images whose state is established elsewhere
+	void setState(VkImage image, const ImageState& state, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+	// discard throws away the current contents, letting the layout change start from undefined
+	void transition(VkImage image, const ImageState& state, bool discard = false);
+	void flush(VkCommandBuffer cmd);
+	void forget(VkImage image);
+
+	const ImageState& state(VkImage image) const;
+	// barrier calls and image barriers written so far, to see what was saved
+	uint32_t flushCount() const { return flushes; }
+	uint32_t barrierCount() const { return barriers; }
+	void resetCounters() { flushes = 0; barriers = 0; }
+private:
+	struct Tracked {
+		ImageState state;
+		VkImageAspectFlags aspect;
+	};
+
+	std::unordered_map<VkImage, Tracked> images;
+	std::vector<VkImageMemoryBarrier2> pending;
+	uint32_t flushes{ 0 };
+	uint32_t barriers{ 0 };
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <vk_types.h>
+#include <vk_culling.h>
+
+struct AABB {
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+// Bounding volume hierarchy over object world bounds. Built with binned SAH, and refit in place when objects
+// move, which keeps the topology and only grows or shrinks node boxes. Every node covers a contiguous range of
+// items, so subtrees entirely inside a query are emitted without visiting their children.
+class BVH {
+public:
+	// items are the object indices of the bounds, boxes are the centre +- extent of every object
+	void build(const culling::BoundsSoA& bounds);
+	// recomputes every box bottom up
+	void refit(const culling::BoundsSoA& bounds);
+	// updates only the moved objects and their ancestors
+	void refit(const culling::BoundsSoA& bounds, std::span<const uint32_t> moved);
+	void clear();
+
+	// appends the objects whose box is inside or crossing all six planes, in no particular order
+	void cull(const glm::vec4 planes[6], std::vector<uint32_t>& visible) const;
+	// appends the objects whose box overlaps the query box
+	void queryBox(const AABB& box, std::vector<uint32_t>& result) const;
+	// nearest object whose box the ray hits within maxDistance, UINT32_MAX when there is none
+	uint32_t raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* hitDistance = nullptr) const;
+
+	// SAH cost relative to the last build, grows as refits loosen the tree
+	float degradation() const;
+	size_t nodeCount() const { return nodes.size(); }
+	bool empty() const { return items.empty(); }
+private:
+	struct Node {
+		glm::vec3 min;
+		uint32_t firstItem;
+		glm::vec3 max;
+		uint32_t itemCount;
+		// children are left and left + 1, zero for leaves as the root is never a child
+		uint32_t left;
+		uint32_t parent;
+	};
+
+	float sahCost() const;
+	void refitNode(uint32_t node);
+
+	std::vector<Node> nodes;
+	// object indices in leaf order, with their boxes in the same order
+	std::vector<uint32_t> items;
+	std::vector<AABB> itemBounds;
+	// position of every object in items, and the leaf holding it
+	std::vector<uint32_t> itemOf;
+	std::vector<uint32_t> leafOf;
+	float builtCost{ 0.f };
+};
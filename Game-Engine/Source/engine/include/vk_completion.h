@@ -0,0 +1,52 @@
+#pragma once
+#include <vk_types.h>
+#include <coroutine>
+#include <mutex>
+
+// Resumes coroutines waiting on the GPU or for the render thread. Awaiting registers the coroutine, poll checks every
+// waiter without blocking and resumes the ready ones on the render thread, so a loader written as sequential code
+// never blocks a thread on a fence. Awaiting is safe from any thread, poll runs once per frame on the render thread.
+class CompletionPoller {
+public:
+	struct Awaiter {
+		CompletionPoller* poller;
+		VkFence fence;
+		VkSemaphore semaphore;
+		uint64_t value;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> handle) { poller->enqueue(Waiter{ handle, fence, semaphore, value }); }
+		void await_resume() const noexcept {}
+	};
+
+	void init(VkDevice device);
+
+	// continues on the render thread at the next poll, for work that records or submits commands
+	Awaiter nextFrame() { return Awaiter{ this, VK_NULL_HANDLE, VK_NULL_HANDLE, 0 }; }
+	// continues on the render thread once the fence is signaled, it is not reset
+	Awaiter fence(VkFence fence) { return Awaiter{ this, fence, VK_NULL_HANDLE, 0 }; }
+	// continues on the render thread once the timeline semaphore has reached value
+	Awaiter timeline(VkSemaphore semaphore, uint64_t value) { return Awaiter{ this, VK_NULL_HANDLE, semaphore, value }; }
+
+	// resumes every waiter that is ready, waiters added while resuming are checked on the next poll
+	void poll();
+
+	// coroutines still waiting, for shutdown checks
+	size_t pending() const;
+private:
+	struct Waiter {
+		std::coroutine_handle<> handle;
+		VkFence fence;
+		VkSemaphore semaphore;
+		uint64_t value;
+	};
+
+	void enqueue(const Waiter& waiter);
+
+	VkDevice device;
+	mutable std::mutex mutex;
+	std::vector<Waiter> waiters;
+	// owned by poll, kept to reuse its capacity
+	std::vector<Waiter> polled;
+	std::vector<std::coroutine_handle<>> ready;
+};
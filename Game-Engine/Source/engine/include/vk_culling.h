@@ -0,0 +1,29 @@
+#pragma once
+#include <vk_types.h>
+
+namespace Core {
+	class ThreadPool;
+}
+
+namespace culling {
+	// world space bounding boxes in SoA layout, padded to a multiple of the SIMD width so the tail needs no special case
+	struct BoundsSoA {
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> extentX, extentY, extentZ;
+		size_t count{ 0 };
+
+		void resize(size_t n);
+		// stores the world space box enclosing the transformed local bounds
+		void set(size_t index, const Bounds& bounds, const glm::mat4& transform);
+	};
+
+	// Gribb-Hartmann extraction, normalised planes facing inwards
+	void extract_planes(const glm::mat4& viewproj, glm::vec4 planes[6]);
+
+	// Appends the indices of the boxes intersecting the frustum to visible, in increasing order. Lists long enough
+	// to be worth it are split across the pool.
+	void cull(const BoundsSoA& bounds, const glm::vec4 planes[6], std::vector<uint32_t>& visible, Core::ThreadPool* pool = nullptr);
+
+	// Single object test projecting the 8 corners of the local box to clip space. Kept as the reference for the batched path.
+	bool is_visible(const Bounds& bounds, const glm::mat4& transform, const glm::mat4& viewproj);
+}
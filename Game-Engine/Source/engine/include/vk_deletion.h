@@ -0,0 +1,59 @@
+#pragma once
+#include <vk_types.h>
+
+// Deferred destruction of GPU objects by type. Every handle is tagged with the frame timeline value after which the
+// GPU no longer uses it, and collect destroys everything the timeline has passed in one go, allocations through a
+// single VMA batch call. Handles are kept in plain arrays, so retiring an object costs no heap allocation once the
+// arrays have grown and no type-erased call, unlike DeletionQueue.
+// Values must be pushed in non-decreasing order per type, which holds for the frame number.
+class TypedDeletionQueue {
+public:
+	void init(VkDevice device, VmaAllocator allocator);
+
+	void destroyBuffer(const AllocatedBuffer& buffer, uint64_t safeAfter);
+	// the view, the image and its allocation
+	void destroyImage(const AllocatedImage& image, uint64_t safeAfter);
+	// an image bound to memory it does not own
+	void destroyImage(VkImage image, uint64_t safeAfter);
+	void destroyImageView(VkImageView view, uint64_t safeAfter);
+	void destroySampler(VkSampler sampler, uint64_t safeAfter);
+	void destroyDescriptorPool(VkDescriptorPool pool, uint64_t safeAfter);
+	void freeMemory(VmaAllocation allocation, uint64_t safeAfter);
+
+	// destroys everything tagged with a value up to completedValue
+	void collect(uint64_t completedValue);
+	// destroys everything, the device must be idle
+	void flush() { collect(UINT64_MAX); }
+
+	size_t pending() const;
+private:
+	template<typename T>
+	struct Batch {
+		std::vector<T> handles;
+		std::vector<uint64_t> values;
+
+		void push(T handle, uint64_t value) {
+			handles.push_back(handle);
+			values.push_back(value);
+		}
+		// number of leading entries the timeline has passed
+		size_t ready(uint64_t completedValue) const {
+			return std::upper_bound(values.begin(), values.end(), completedValue) - values.begin();
+		}
+		void drop(size_t count) {
+			handles.erase(handles.begin(), handles.begin() + count);
+			values.erase(values.begin(), values.begin() + count);
+		}
+	};
+
+	VkDevice device;
+	VmaAllocator allocator;
+
+	// views go before images and buffers before their memory, so the order of collect matters
+	Batch<VkImageView> views;
+	Batch<VkSampler> samplers;
+	Batch<VkDescriptorPool> pools;
+	Batch<VkBuffer> buffers;
+	Batch<VkImage> images;
+	Batch<VmaAllocation> allocations;
+};
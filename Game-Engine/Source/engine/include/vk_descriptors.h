@@ -1,5 +1,7 @@
 #pragma once
 #include <vk_types.h>
+#include <vk_deletion.h>
+#include <Core/FrameArena.h>
 
 struct DescriptorLayoutBuilder {
 	std::vector<VkDescriptorSetLayoutBinding> bindings;
@@ -34,6 +36,8 @@ public:
 	void init(VkDevice device, uint32_t initialSets, std::span<PoolSizeRatio> poolRatios);
 	void clearPools(VkDevice device);
 	void destroyPools(VkDevice device);
+	// hands the pools to the deletion queue, for sets frames in flight may still have bound
+	void destroyPools(TypedDeletionQueue& deletion, uint64_t safeAfter);
 	VkDescriptorSet allocate(VkDevice device, VkDescriptorSetLayout layout, void* pNext = nullptr);
 private:
 	VkDescriptorPool getPool(VkDevice device);
@@ -47,9 +51,12 @@ private:
 };
 
 struct DescriptorWriter {
-	std::deque<VkDescriptorImageInfo> imageInfos;
-	std::deque<VkDescriptorBufferInfo> bufferInfos;
-	std::vector<VkWriteDescriptorSet> writes;
+	// per frame writers pass the frame's arena, the others allocate from the heap
+	DescriptorWriter(Core::FrameArena* arena = nullptr) : imageInfos(arena), bufferInfos(arena), writes(arena) {}
+
+	std::deque<VkDescriptorImageInfo, Core::ArenaAllocator<VkDescriptorImageInfo>> imageInfos;
+	std::deque<VkDescriptorBufferInfo, Core::ArenaAllocator<VkDescriptorBufferInfo>> bufferInfos;
+	Core::ArenaVector<VkWriteDescriptorSet> writes;
 
 	void writeImage(uint32_t binding,VkImageView image, VkSampler sampler, VkImageLayout layout, VkDescriptorType type);
 	void writeBuffer(uint32_t binding, VkBuffer buffer, size_t size, size_t offset, VkDescriptorType type);
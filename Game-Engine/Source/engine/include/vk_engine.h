@@ -2,6 +2,7 @@
 
 #include <vk_types.h>
 
+#include <chrono>
 #include <deque>
 #include <functional>
 #include <span>
@@ -11,10 +12,25 @@
 
 #include <vk_mem_alloc.h>
 
+#include <benchmark.h>
 #include <camera.h>
+#include <Core/FrameArena.h>
+#include <Core/Profiler.h>
+#include <Core/ThreadPool.h>
+#include <vk_barriers.h>
+#include <vk_completion.h>
+#include <vk_culling.h>
+#include <vk_deletion.h>
+#include <vk_sort.h>
 #include <vk_descriptors.h>
+#include <vk_geometry_pool.h>
+#include <vk_gpu_profiler.h>
 #include <vk_loader.h>
 #include <vk_pipelines.h>
+#include <vk_render_graph.h>
+#include <vk_render_list.h>
+#include <vk_resolution.h>
+#include <vk_scene_loader.h>
 struct MeshAsset;
 namespace fastgltf {
 	struct Mesh;
@@ -27,25 +43,39 @@ struct EngineStats {
 	int drawcall_count;
 	int scene_update_time;
 	float mesh_draw_time;
-};
-
-struct RenderObject {
-	uint32_t indexCount;
-	uint32_t firstIndex;
-	VkBuffer indexBuffer;
-	MaterialInstance* material;
-	Bounds bounds;
-	glm::mat4 transform;
-	VkDeviceAddress vertexBufferAddress;
+	// time spent waiting for the frame slot to be released by the GPU
+	float fence_wait_time;
+	// from the camera update to the CPU seeing the frame complete on the GPU, input to present minus the time the
+	// presentation engine queues the image
+	float input_latency;
 };
 
 struct FrameData {	
 	VkCommandPool commandPool;
 	VkCommandBuffer commandBuffer;
-	VkSemaphore swapchainSemaphore, renderSemaphore;
-	VkFence renderFence;
+	// signaled by the acquire, the GPU waits on it before writing the swapchain image
+	VkSemaphore swapchainSemaphore;
+	// value of the frame timeline signaled when this slot's last submission completed
+	uint64_t timelineValue{ 0 };
+	std::chrono::system_clock::time_point inputTime;
+	bool latencyPending{ false };
 	DynamicDescriptorAllocator descriptorAllocator;
+	// CPU data recorded for this frame, reset once the slot's timeline value is reached
+	Core::FrameArena arena;
 	DeletionQueue deletionQueue;
+	AllocatedBuffer meshletJobBuffer;
+	AllocatedBuffer meshletCommandBuffer;
+	uint32_t meshletJobCapacity{ 0 };
+	uint32_t meshletCommandCapacity{ 0 };
+
+	AllocatedBuffer instanceBuffer;
+	uint32_t instanceCapacity{ 0 };
+
+	// headless frame captures, written to PNG once the frame's timeline value has been waited on
+	AllocatedBuffer readbackBuffer;
+	uint32_t readbackCapacity{ 0 };
+	int captureFrame{ -1 };
+	VkExtent2D captureExtent;
 };
 
 struct ComputeEffect {
@@ -62,25 +92,25 @@ struct GPUSceneData {
 	glm::vec4 ambientColor;
 	glm::vec4 sunlightDirection;
 	glm::vec4 sunlightColor;
+	glm::vec4 frustumPlanes[6];
+	glm::vec4 cameraPosition;
 };	
 
 struct MeshNode : public Node {
-	std::shared_ptr<MeshAsset> mesh;
+	MeshHandle mesh;
 	virtual void Draw(const glm::mat4& topMatrix, DrawContext& ctx) override;
 };
 
-struct DrawContext {
-	std::vector<RenderObject> OpaqueSurfaces;
-	std::vector<RenderObject> TransparentSurfaces;
-};
-
-constexpr unsigned int FRAME_OVERLAP = 2;
+constexpr unsigned int MAX_FRAMES_IN_FLIGHT = 3;
+// render targets grow in steps of this many pixels per side
+constexpr uint32_t RENDER_TARGET_GRANULARITY = 256;
 
 struct GLTFMetallic_Roughness {
 	MaterialPipeline opaquePipeline;
 	MaterialPipeline transparentPipeline;
 
 	VkDescriptorSetLayout materialLayout;
+	uint32_t materialCount{ 0 };
 
 	struct MaterialConstants {
 		glm::vec4 colorFactor;
@@ -109,16 +139,34 @@ class VulkanEngine {
 public:
 	EngineStats stats;
 	Camera camera;
-	DrawContext drawContext;
+	RenderList renderList;
 	std::unordered_map<std::string, std::shared_ptr<Node>> loadedNodes;
-	FrameData frames[FRAME_OVERLAP];
-	FrameData& get_current_frame() { return frames[frameNumber % FRAME_OVERLAP]; }
+	FrameData frames[MAX_FRAMES_IN_FLIGHT];
+	// 1 to MAX_FRAMES_IN_FLIGHT, fixed at init. Fewer frames lower latency, more keep the GPU busy through CPU spikes
+	uint32_t framesInFlight{ 2 };
+	FrameData& get_current_frame() { return frames[frameNumber % framesInFlight]; }
+	// requested present mode, replaced by FIFO when the surface does not support it
+	VkPresentModeKHR presentMode{ VK_PRESENT_MODE_FIFO_KHR };
+	// frame n signals n + 1 when its submission completes, the CPU waits on it before reusing a frame slot
+	VkSemaphore frameTimeline;
 	VkQueue graphicsQueue;
 	uint32_t graphicsQueueFamily;
 	bool isInitialized{ false };
 	int frameNumber{ 0 };
 	bool stopRendering{ false };
 	bool resizeRequest{ false };
+	bool fullscreen{ false };
+	// renders drawImage offscreen without SDL, a surface or a swapchain, for benchmark and regression runs
+	bool headless{ false };
+	uint32_t headlessFrames{ 100 };
+	// every n-th headless frame is read back to capture_<frame>.png, 0 disables captures
+	uint32_t captureInterval{ 0 };
+	// camera path replayed at a fixed timestep in place of user input, empty runs interactively
+	std::string benchmarkPath;
+	std::string benchmarkReport{ "benchmark.csv" };
+	float benchmarkTimestep{ 1.f / 60.f };
+	// render scale for the whole replay, the resolution controller and the slider are bypassed so runs stay comparable
+	float benchmarkScale{ 1.f };
 	VkExtent2D windowExtent{ 1100, 900 };
 	struct SDL_Window* window{ nullptr };
 	AllocatedImage drawImage;
@@ -131,26 +179,65 @@ public:
 	VkSampler defaultSamplerNearest;
 	VkExtent2D drawExtent;
 	float renderScale{ 1.0f };
+	// adjusts renderScale toward resolution.targetMs of GPU time, windowed only so headless runs stay reproducible
+	bool dynamicResolution{ true };
+	ResolutionController resolution;
+	// scaled frames are upscaled with a sharpening compute pass instead of a linear blit
+	bool sharpenUpscale{ true };
+	float sharpness{ 0.5f };
+	float lodBias{ 1.0f };
 	VkInstance instance;
 	VkDebugUtilsMessengerEXT debugMessenger;
 	VkPhysicalDevice chosenGPU;
 	VkDevice driver;
 	VkSurfaceKHR surface;
-	VkSwapchainKHR swapchain;
+	VkSwapchainKHR swapchain{ VK_NULL_HANDLE };
 	VkFormat swapchainImageFormat;
 	std::vector<VkImage> swapchainImages;
 	std::vector<VkImageView> swapchainImageViews;
+	// one per swapchain image, as the presentation engine holds it until that image is acquired again
+	std::vector<VkSemaphore> presentSemaphores;
+	// a replaced swapchain with its views and present semaphores, kept until the new one has presented every image
+	struct RetiredSwapchain {
+		VkSwapchainKHR swapchain;
+		std::vector<VkImageView> views;
+		std::vector<VkSemaphore> presentSemaphores;
+		uint32_t presentsLeft;
+	};
+	std::vector<RetiredSwapchain> retiredSwapchains;
 	VkExtent2D swapchainExtent;
 	DeletionQueue mainDeletionQueue;
+	// per frame GPU resources, tagged with the frame timeline value of their last use
+	TypedDeletionQueue deferredDeletion;
+	AssetPools assets;
 	VmaAllocator allocator;
+	GeometryPool geometryPool;
+	BarrierTracker barriers;
+	RenderGraph renderGraph;
+	GpuProfiler gpuProfiler;
+	Core::ThreadPool threadPool;
+	// BVH culling output, kept across frames like the sort buffers
+	std::vector<uint32_t> visibleOpaque;
+	std::vector<drawsort::Item> drawSortItems;
+	std::vector<drawsort::Item> drawSortScratch;
+	uint32_t meshCount{ 0 };
 	DynamicDescriptorAllocator globalDescriptorAllocator;
 	VkDescriptorSet drawImageDescriptors;
+	DescriptorAllocator drawImageDescriptorPool{};
 	VkDescriptorSetLayout drawImageDescriptorLayout;
 	VkDescriptorSetLayout singleImageDescriptorLayout;
 	VkPipeline  currentPipeline;
 	VkPipelineLayout backgroundPipelineLayout;
 	VkPipelineLayout meshPipelineLayout;
 	VkPipeline meshPipeline;
+	VkPipelineLayout meshletCullPipelineLayout;
+	VkPipeline meshletCullPipeline;
+	VkDescriptorSetLayout upscaleDescriptorLayout;
+	VkPipelineLayout upscalePipelineLayout;
+	VkPipeline upscalePipeline;
+	bool meshShaderSupported{ false };
+	VkShaderStageFlags geometryStages{ VK_SHADER_STAGE_VERTEX_BIT };
+	PFN_vkCmdDrawMeshTasksEXT cmdDrawMeshTasks{ nullptr };
 	VkFence immFence;
 	VkCommandBuffer immCmdBuffer;
 	VkCommandPool immCmdPool;
@@ -158,10 +245,12 @@ public:
 	VkDescriptorSetLayout gpuSceneDescriptorSetLayout;
 	std::vector<ComputeEffect> backgroundEffects;
 	int currentBackgroundEffect{ 0 };
-	MaterialInstance defaultMat;
+	MaterialHandle defaultMat;
 	GLTFMetallic_Roughness metalRoughMat;
-	std::vector<std::shared_ptr<MeshAsset>> sceneMeshes;
+	std::vector<MeshHandle> sceneMeshes;
 	std::unordered_map<std::string, std::shared_ptr<LoadedGLTF>> loadedScenes;
+	CompletionPoller completions;
+	AsyncSceneLoader sceneLoader;
 
 
 	static VulkanEngine& get();
@@ -171,9 +260,16 @@ public:
 	void run();
 	void immediate_cmd(std::function<void(VkCommandBuffer cmd)>&& function);
 	GPUMeshBuffers uploadMesh(std::span<uint32_t> indices, std::span<Vertex> vertices);
+	void uploadMeshlets(GPUMeshBuffers& mesh, MeshletData& meshlets);
+	// record the copies into cmd instead of submitting them, the staging buffers must live until cmd has completed
+	GPUMeshBuffers uploadMesh(VkCommandBuffer cmd, std::span<uint32_t> indices, std::span<Vertex> vertices, std::vector<AllocatedBuffer>& staging);
+	void uploadMeshlets(VkCommandBuffer cmd, GPUMeshBuffers& mesh, MeshletData& meshlets, std::vector<AllocatedBuffer>& staging);
+	void destroyMesh(const GPUMeshBuffers& mesh);
+	VkDeviceAddress getBufferAddress(VkBuffer buffer);
 	AllocatedBuffer createBuffer(size_t allocSize, VkBufferUsageFlags flags, VmaMemoryUsage memoryUsage);
 	AllocatedImage createImage(VkExtent3D size, VkFormat format, VkImageUsageFlags flags, bool mipmapped = false);
 	AllocatedImage createImage(void* data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped = false);
+	AllocatedImage createImage(VkCommandBuffer cmd, void* data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped, std::vector<AllocatedBuffer>& staging);
 	void destroyImage(const AllocatedImage& image);
 	void destroyBuffer(const AllocatedBuffer& buffer);
 
@@ -185,17 +281,40 @@ private:
 	void initCommands();
 	void initSyncStructures();
 	void createSwapchain(uint32_t width, uint32_t height);
+	void destroyRetiredSwapchain(const RetiredSwapchain& retired);
+	void createRenderTargets(VkExtent2D extent);
+	void writeDrawImageDescriptors();
 	void drawBackground(VkCommandBuffer cmd);
+	void drawUpscale(VkCommandBuffer cmd, VkImageView target);
 	void initDescriptors();
 	void initPipelines();
 	void initGradientPipelines();
 	void initMeshPipeline();
+	void initMeshletCullPipeline();
+	void initUpscalePipeline();
+	void reserveFrameBuffer(AllocatedBuffer& buffer, uint32_t& capacity, uint32_t count, size_t stride, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, uint32_t minCapacity);
+	void cullMeshlets(VkCommandBuffer cmd, std::span<const GPUMeshletCullJob> jobs, uint32_t commandCount);
 	void initImGui();
 	void resizeSwapchain();
 	void drawImGui(VkCommandBuffer cmd, VkImageView targetImageview);
 	void drawMesh(VkCommandBuffer cmd);
 	void init_default_data();
 	void destroySwapchain();
+	// dumps the CPU zones as a Chrome trace, bound to F12 and run at exit
+	void writeTrace();
+	void runHeadless();
+	void writeCapture(FrameData& frame);
+	void recordBenchmarkFrame();
+	// measures input latency for the frame slots whose timeline value has been reached
+	void collectLatency();
+	// destroys released assets whose last frame has completed
+	void collectAssets(uint64_t completedValue);
+
+	CameraBenchmark benchmark;
+	// F9 records the flown camera into camera_path.txt for later benchmark runs
+	CameraPath recordedPath;
+	bool recordingPath{ false };
+	float recordingTime{ 0.f };
 };
 
 
@@ -0,0 +1,37 @@
+#pragma once
+#include <vk_types.h>
+
+// Vertex and index storage shared by every mesh. Meshes get ranges of a few large buffers instead of buffers of
+// their own, so draws only differ in firstIndex and vertexOffset. Ranges come from VMA virtual blocks, which
+// coalesce freed neighbours. A new page is added once the existing ones are full.
+class GeometryPool {
+public:
+	struct Page {
+		AllocatedBuffer vertexBuffer;
+		AllocatedBuffer indexBuffer;
+		VkDeviceAddress vertexBufferAddress;
+		VmaVirtualBlock vertexBlock;
+		VmaVirtualBlock indexBlock;
+	};
+
+	// page sizes are in vertices and index bytes
+	void init(VkDevice device, VmaAllocator allocator, uint32_t vertexPageSize, VkDeviceSize indexPageSize);
+	void destroy();
+
+	bool allocate(uint32_t vertexCount, VkDeviceSize indexBytes, GeometryAllocation& out);
+	void free(const GeometryAllocation& allocation);
+
+	const Page& page(uint32_t index) const { return pages[index]; }
+	size_t pageCount() const { return pages.size(); }
+	VkDeviceSize usedBytes() const;
+	VkDeviceSize capacityBytes() const;
+private:
+	bool tryAllocate(uint32_t pageIndex, uint32_t vertexCount, VkDeviceSize indexBytes, GeometryAllocation& out);
+	void addPage(uint32_t vertexSize, VkDeviceSize indexSize);
+
+	VkDevice device;
+	VmaAllocator allocator;
+	uint32_t vertexPageSize;
+	VkDeviceSize indexPageSize;
+	std::vector<Page> pages;
+};
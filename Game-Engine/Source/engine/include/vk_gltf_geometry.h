@@ -0,0 +1,9 @@
+#pragma once
+#include <vk_types.h>
+#include <fastgltf/types.hpp>
+
+namespace gltf_geometry {
+	// Appends the indices and vertices of one primitive, rebasing its indices onto the vertices already present.
+	// Missing normals, UVs and colors keep defaults. Returns the local bounds of the appended vertices.
+	Bounds append_primitive(fastgltf::Asset& gltf, fastgltf::Primitive& primitive, std::vector<uint32_t>& indices, std::vector<Vertex>& vertices);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <vk_types.h>
+
+// GPU timings of named scopes from timestamp queries. Every frame in flight has its own query pool, which is read
+// back when the frame comes around again, after the engine waited for it to complete, so reading never stalls the
+// GPU. Results are therefore as many frames old as there are frames in flight.
+class GpuProfiler {
+public:
+	static constexpr uint32_t MAX_SCOPES = 32;
+	// frames kept for the rolling average and p99
+	static constexpr uint32_t HISTORY = 256;
+
+	struct ScopeStats {
+		std::string name;
+		float lastMs{ 0.f };
+		float averageMs{ 0.f };
+		float p99Ms{ 0.f };
+	};
+
+	void init(VkDevice device, VkPhysicalDevice gpu, uint32_t queueFamily, uint32_t frameCount);
+	void destroy();
+
+	// collects the results the frame slot recorded last time and resets its queries, the slot's previous frame must have completed
+	void beginFrame(VkCommandBuffer cmd, uint32_t frame);
+	// returns the scope index to hand to end, scopes past MAX_SCOPES are not timed
+	uint32_t begin(VkCommandBuffer cmd, const char* name);
+	void end(VkCommandBuffer cmd, uint32_t scope);
+
+	bool enabled() const { return supported; }
+	// per scope name in first seen order
+	const std::vector<ScopeStats>& results() const { return stats; }
+	// first begin to last end of the last collected frame
+	const ScopeStats& frame() const { return frameStats; }
+private:
+	struct FrameQueries {
+		VkQueryPool pool{ VK_NULL_HANDLE };
+		std::vector<const char*> names;
+		bool recorded{ false };
+	};
+
+	struct History {
+		std::array<float, HISTORY> samples{};
+		uint32_t count{ 0 };
+		uint32_t next{ 0 };
+	};
+
+	void collect(FrameQueries& frame);
+	void addSample(ScopeStats& scope, History& history, float ms);
+
+	VkDevice device;
+	bool supported{ false };
+	float timestampPeriod{ 1.f };
+	uint64_t timestampMask{ ~0ull };
+	std::vector<FrameQueries> frames;
+	uint32_t currentFrame{ 0 };
+
+	std::vector<ScopeStats> stats;
+	std::vector<History> histories;
+	ScopeStats frameStats{ "frame" };
+	History frameHistory;
+	std::vector<uint64_t> timestamps;
+	std::vector<float> sorted;
+};
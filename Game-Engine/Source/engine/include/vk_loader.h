@@ -1,26 +1,32 @@
 #pragma once
 #include <vk_types.h>
 #include "vk_descriptors.h"
+#include "vk_meshlets.h"
+#include "vk_scene.h"
 #include <unordered_map>
 #include <filesystem>
+#include <cstdlib>
 
 class VulkanEngine;
 
-struct Bounds {
-	glm::vec3 origin;
-	float sphereRadius;
-	glm::vec3 extents;
-};
+constexpr uint32_t MAX_MESH_LODS = 4;
 
-struct GLTFMaterial {
-	MaterialInstance data;
+struct MeshLod {
+	uint32_t startIndex;
+	uint32_t count;
 };
 
 struct GeoSurface {
 	uint32_t startIndex;
 	uint32_t count;
 	Bounds bounds;
-	std::shared_ptr<GLTFMaterial> material;
+	MaterialHandle material;
+	// lods[0] is the full detail range, coarser levels index the same vertices
+	std::array<MeshLod, MAX_MESH_LODS> lods;
+	uint32_t lodCount;
+	// meshlets of the full detail range, zero for surfaces too small to cluster
+	uint32_t meshletOffset{ 0 };
+	uint32_t meshletCount{ 0 };
 };
 
 struct MeshAsset {
@@ -29,17 +35,32 @@ struct MeshAsset {
 	GPUMeshBuffers meshBuffers;
 };
 
+// storage of every loaded asset, everything else refers to assets by handle
+struct AssetPools {
+	ResourcePool<MeshAsset> meshes;
+	ResourcePool<MaterialInstance> materials;
+	ResourcePool<AllocatedImage> images;
+};
+
 struct LoadedGLTF : public IRenderable {
 public:
-	std::unordered_map<std::string, std::shared_ptr<MeshAsset>> meshes;
-	std::unordered_map<std::string, std::shared_ptr<Node>> nodes;
-	std::unordered_map<std::string, AllocatedImage> images;
-	std::unordered_map<std::string, std::shared_ptr<GLTFMaterial>> materials;
+	// handles into the engine's asset pools by name, for lookup only. glTF names are optional and may repeat, so
+	// a name keeps the last asset that carried it
+	std::unordered_map<std::string, MeshHandle> meshes;
+	// node name to its index in the graph
+	std::unordered_map<std::string, uint32_t> nodes;
+	std::unordered_map<std::string, ImageHandle> images;
+	std::unordered_map<std::string, MaterialHandle> materials;
 
-	std::vector<std::shared_ptr<Node>> topNodes;
+	// every handle the file owns in file order, released with the file
+	std::vector<MeshHandle> ownedMeshes;
+	std::vector<ImageHandle> ownedImages;
+	std::vector<MaterialHandle> ownedMaterials;
+
+	SceneGraph graph;
 	std::vector<VkSampler> samplers;
 	DynamicDescriptorAllocator descriptorPool;
-	AllocatedBuffer materialDataBuffer;
+	AllocatedBuffer materialDataBuffer{};
 	VulkanEngine* creator;
 	~LoadedGLTF() { clearAll(); };
 
@@ -48,6 +69,78 @@ private:
 	void clearAll();
 };
 
-std::optional<std::vector<std::shared_ptr<MeshAsset>>> load_gltf_meshes(VulkanEngine * engine, const std::filesystem::path & path);
+// a glTF as far as it can be prepared without the GPU: parsed, images decoded, meshes assembled with their LODs and
+// meshlets. Building it makes no Vulkan calls, so it can run on any thread
+struct GLTFSceneData {
+	struct Image {
+		std::string name;
+		VkExtent3D extent;
+		// RGBA8, null when decoding failed
+		std::unique_ptr<unsigned char, void (*)(void*)> pixels{ nullptr, free };
+	};
+
+	struct Material {
+		std::string name;
+		glm::vec4 colorFactor;
+		glm::vec4 metalRoughFactor;
+		MaterialPass passType;
+		uint32_t colorImage{ UINT32_MAX };
+		uint32_t colorSampler{ UINT32_MAX };
+	};
+
+	struct Mesh {
+		std::string name;
+		std::vector<uint32_t> indices;
+		std::vector<Vertex> vertices;
+		// materials are set on upload from surfaceMaterials
+		std::vector<GeoSurface> surfaces;
+		std::vector<uint32_t> surfaceMaterials;
+		MeshletData meshlets;
+	};
+
+	// breadth first, parent indexes this array
+	struct Node {
+		std::string name;
+		uint32_t parent;
+		glm::mat4 localTransform;
+		uint32_t mesh{ UINT32_MAX };
+	};
+
+	std::vector<VkSamplerCreateInfo> samplers;
+	std::vector<Image> images;
+	std::vector<Material> materials;
+	std::vector<Mesh> meshes;
+	std::vector<Node> nodes;
+};
+
+// Creates the GPU side of a parsed glTF a slice at a time, so the uploads can be spread over frames. Every step
+// records its copies into cmd and appends its staging buffers, both have to outlive the submission.
+class GLTFUpload {
+public:
+	GLTFUpload(VulkanEngine* engine, GLTFSceneData data);
+
+	// byteBudget bounds the staging memory of one step, one image or mesh always fits. True once everything is recorded
+	bool step(VkCommandBuffer cmd, std::vector<AllocatedBuffer>& staging, size_t byteBudget);
+	// usable once the submission of the last step has completed
+	std::shared_ptr<LoadedGLTF> scene() const { return file; }
+private:
+	void createMaterials();
+	void buildGraph();
+
+	VulkanEngine* engine;
+	GLTFSceneData data;
+	std::shared_ptr<LoadedGLTF> file;
+	std::vector<AllocatedImage> images;
+	std::vector<MaterialHandle> materials;
+	std::vector<MeshHandle> meshes;
+	size_t nextImage{ 0 };
+	size_t nextMesh{ 0 };
+	bool materialsCreated{ false };
+	bool done{ false };
+};
+
+std::optional<GLTFSceneData> parse_gltf(const std::filesystem::path& path);
+
+std::optional<std::vector<MeshHandle>> load_gltf_meshes(VulkanEngine * engine, const std::filesystem::path & path);
 std::optional<std::shared_ptr<LoadedGLTF>> load_gltf(VulkanEngine* engine, const std::filesystem::path& path);
 
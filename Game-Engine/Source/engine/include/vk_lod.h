@@ -0,0 +1,10 @@
+#pragma once
+#include <vk_types.h>
+
+namespace lod {
+	// Quadric error edge-collapse simplification. The result indexes the same vertex array as the input, so
+	// every LOD of a surface can share the vertex buffer of the full detail mesh.
+	// Border and attribute seam vertices are locked, and collapses whose error exceeds maxError (object space units)
+	// are rejected, so the result may keep more than targetIndexCount indices.
+	std::vector<uint32_t> simplify(std::span<const uint32_t> indices, std::span<const Vertex> vertices, size_t targetIndexCount, float maxError, float* outError = nullptr);
+}
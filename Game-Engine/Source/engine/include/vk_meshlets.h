@@ -0,0 +1,38 @@
+#pragma once
+#include <vk_types.h>
+
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+// surfaces smaller than this are cheaper to draw whole than to cull per cluster
+constexpr uint32_t MESHLET_MIN_SURFACE_TRIANGLES = 512;
+// meshlets culled by one task shader workgroup, matches meshlet_draw.glsl
+constexpr uint32_t MESHLET_TASK_GROUP_SIZE = 32;
+
+// matches the Meshlet struct in meshlet.glsl
+struct GPUMeshlet {
+	glm::vec4 sphere;        // object space center, radius
+	glm::vec4 cone;          // normal cone axis, sine of its half angle (1 disables cone culling)
+	uint32_t firstIndex;     // range of the mesh index buffer holding the meshlet triangles
+	uint32_t indexCount;
+	uint32_t vertexOffset;   // in 32 bit words from the start of the meshlet buffer
+	uint32_t triangleOffset; // in bytes from the start of the meshlet buffer
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+	uint32_t padding[2];
+};
+
+struct MeshletData {
+	std::vector<GPUMeshlet> meshlets;
+	std::vector<uint32_t> vertices;
+	std::vector<uint8_t> triangles;
+};
+
+namespace meshlet {
+	// Clusters the triangles of indices[startIndex, startIndex + count) into meshlets and reorders that range so every
+	// meshlet covers a contiguous run of the index buffer. Offsets written into the meshlets are relative to the
+	// arrays of out until fixup_offsets is called. Returns the number of meshlets appended.
+	uint32_t build(std::span<uint32_t> indices, uint32_t startIndex, uint32_t count, std::span<const Vertex> vertices, bool coneCulling, MeshletData& out);
+
+	// rebases the meshlet vertex and triangle offsets onto the [meshlets][vertices][triangles] buffer layout
+	void fixup_offsets(MeshletData& data);
+}
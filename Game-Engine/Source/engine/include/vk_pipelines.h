@@ -26,6 +26,7 @@ public:
     VkPipeline buildPipeline(VkDevice device);
 
     void setShaders(VkShaderModule vertexShader, VkShaderModule fragmentShader);
+    void setMeshShaders(VkShaderModule taskShader, VkShaderModule meshShader, VkShaderModule fragmentShader);
     void setInputTopology(VkPrimitiveTopology topology);
     void setPolygonMode(VkPolygonMode mode);
     void setCullMode(VkCullModeFlags cullMode, VkFrontFace fronFace);
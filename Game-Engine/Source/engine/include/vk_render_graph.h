@@ -0,0 +1,123 @@
+#pragma once
+#include <vk_types.h>
+#include <vk_barriers.h>
+#include <vk_gpu_profiler.h>
+#include <vk_deletion.h>
+
+// Frame graph rebuilt every frame. Passes declare which images they read and write and in which state, the graph
+// culls passes whose results never reach an output, places the barriers between passes and gives transient
+// images memory that is shared between images whose lifetimes do not overlap. Passes run in declaration order,
+// which is already a valid order as a pass can only read what earlier passes wrote.
+class RenderGraph {
+public:
+	using Resource = uint32_t;
+
+	struct ImageDesc {
+		VkFormat format;
+		VkExtent2D extent;
+		VkImageUsageFlags usage;
+		VkImageAspectFlags aspect{ VK_IMAGE_ASPECT_COLOR_BIT };
+	};
+
+	class PassBuilder {
+	public:
+		void read(Resource resource, const ImageState& state);
+		// discard marks a write that does not depend on the previous contents
+		void write(Resource resource, const ImageState& state, bool discard = false);
+		// keeps the pass even when nothing reads what it writes
+		void sideEffects();
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& graph, uint32_t pass) : graph(graph), pass(pass) {}
+		RenderGraph& graph;
+		uint32_t pass;
+	};
+
+	void init(VkDevice device, VmaAllocator allocator);
+	// releases the transient images, the caller makes sure the GPU is done with them
+	void destroy(BarrierTracker& barriers);
+
+	// starts a new frame, transient images are kept and reused while their descriptions stay the same
+	void reset();
+	Resource importImage(const char* name, VkImage image, VkImageView view);
+	Resource createImage(const char* name, const ImageDesc& desc);
+	// marks the resource as a graph output, left in the given state after the last pass
+	void setFinalState(Resource resource, const ImageState& state);
+	void addPass(const char* name, const std::function<void(PassBuilder&)>& setup, std::function<void(VkCommandBuffer)> execute);
+
+	// replaced transient images are handed to the deletion queue as frames in flight may still use them and dropped
+	// from the barrier tracker, safeAfter is the timeline value of the frame being recorded
+	void compile(TypedDeletionQueue& deletion, BarrierTracker& barriers, uint64_t safeAfter);
+	// with a profiler every pass is timed under its name, barriers included
+	void execute(VkCommandBuffer cmd, BarrierTracker& barriers, GpuProfiler* profiler = nullptr);
+
+	VkImage image(Resource resource) const { return resources[resource].image; }
+	VkImageView view(Resource resource) const { return resources[resource].view; }
+
+	size_t passCount() const { return passes.size(); }
+	size_t culledPassCount() const;
+	// memory of the transient images with and without aliasing
+	VkDeviceSize transientBytes() const { return transientMemorySize; }
+	VkDeviceSize unaliasedBytes() const { return unaliasedMemorySize; }
+private:
+	struct Access {
+		Resource resource;
+		ImageState state;
+		bool write;
+		bool discard;
+	};
+
+	struct Pass {
+		const char* name;
+		std::vector<Access> accesses;
+		std::function<void(VkCommandBuffer)> execute;
+		bool sideEffects{ false };
+		bool culled{ false };
+	};
+
+	struct ResourceNode {
+		const char* name;
+		bool transient;
+		ImageDesc desc;
+		VkImage image;
+		VkImageView view;
+		bool output{ false };
+		ImageState finalState;
+		// alive passes using the resource, for transient lifetimes
+		uint32_t firstPass{ UINT32_MAX };
+		uint32_t lastPass{ 0 };
+		VkDeviceSize memoryOffset{ 0 };
+		// transients sharing memory with this one, their last use has to finish before its first
+		std::vector<Resource> aliases;
+	};
+
+	// physical transient image kept between frames
+	struct TransientImage {
+		ImageDesc desc;
+		uint32_t firstPass;
+		uint32_t lastPass;
+		VkImage image;
+		VkImageView view;
+		VkDeviceSize offset;
+		VmaAllocation allocation;
+		std::vector<uint32_t> aliases;
+	};
+
+	void cullPasses();
+	void computeLifetimes();
+	bool transientsMatch() const;
+	void allocateTransients(TypedDeletionQueue& deletion, BarrierTracker& barriers, uint64_t safeAfter);
+	void releaseTransients(TypedDeletionQueue* deletion, BarrierTracker& barriers, uint64_t safeAfter);
+
+	VkDevice device;
+	VmaAllocator allocator;
+
+	std::vector<Pass> passes;
+	std::vector<ResourceNode> resources;
+	// transient resources in creation order, the cache matches them by position
+	std::vector<Resource> transients;
+	std::vector<TransientImage> transientImages;
+	VmaAllocation sharedAllocation{ VK_NULL_HANDLE };
+	VkDeviceSize transientMemorySize{ 0 };
+	VkDeviceSize unaliasedMemorySize{ 0 };
+};
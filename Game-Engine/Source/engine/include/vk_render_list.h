@@ -0,0 +1,77 @@
+#pragma once
+#include <vk_types.h>
+#include <vk_culling.h>
+#include <vk_bvh.h>
+
+struct MeshLod;
+
+struct RenderObject {
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	VkBuffer indexBuffer;
+	VkIndexType indexType;
+	// position of the mesh inside the geometry pool, lod ranges are relative to it
+	uint32_t baseIndex;
+	int32_t vertexOffset;
+	// mesh id and surface index, identifies the geometry for draw sorting
+	uint32_t geometryId;
+	MaterialHandle material;
+	Bounds bounds;
+	glm::mat4 transform;
+	VkDeviceAddress vertexBufferAddress;
+	const MeshLod* lods;
+	uint32_t lodCount;
+	VkDeviceAddress meshletBufferAddress;
+	VkDeviceAddress meshletDataAddress;
+	uint32_t meshletCount;
+};
+
+struct DrawContext {
+	std::vector<RenderObject> OpaqueSurfaces;
+	std::vector<RenderObject> TransparentSurfaces;
+};
+
+struct RenderHandle {
+	uint32_t slot{ UINT32_MAX };
+	uint32_t generation{ 0 };
+};
+
+// Render objects kept across frames. Every object has a stable handle, the renderer reads the dense per pass arrays
+// directly. Opaque world bounds are kept ready for culling and only recomputed for objects added or moved, so a
+// frame without changes does no per object work before culling.
+class RenderList {
+public:
+	RenderHandle add(const RenderObject& object, bool transparent);
+	void add(const DrawContext& ctx, std::vector<RenderHandle>* handles = nullptr);
+	void remove(RenderHandle handle);
+	void setTransform(RenderHandle handle, const glm::mat4& transform);
+	bool contains(RenderHandle handle) const;
+	void clear();
+
+	const std::vector<RenderObject>& opaque() const { return opaqueObjects; }
+	const std::vector<RenderObject>& transparent() const { return transparentObjects; }
+	const culling::BoundsSoA& opaqueBounds() const { return bounds; }
+	// hierarchy over opaqueBounds, rebuilt after objects were added or removed and refit after they moved
+	const BVH& opaqueBvh();
+	size_t size() const { return opaqueObjects.size() + transparentObjects.size(); }
+private:
+	struct Slot {
+		uint32_t generation{ 0 };
+		bool transparent{ false };
+		// position in the dense array, or the next free slot once released
+		uint32_t index{ UINT32_MAX };
+	};
+
+	std::vector<Slot> slots;
+	uint32_t freeSlot{ UINT32_MAX };
+
+	std::vector<RenderObject> opaqueObjects;
+	std::vector<uint32_t> opaqueSlots;
+	culling::BoundsSoA bounds;
+	BVH bvh;
+	bool bvhStale{ true };
+	std::vector<uint32_t> movedOpaque;
+	// transparent objects keep their submission order
+	std::vector<RenderObject> transparentObjects;
+	std::vector<uint32_t> transparentSlots;
+};
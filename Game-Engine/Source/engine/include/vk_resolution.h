@@ -0,0 +1,34 @@
+#pragma once
+#include <vk_types.h>
+
+// Steers the render scale toward a GPU frame time budget. GPU time is taken as proportional to the rendered pixel
+// count, so the scale moves by the square root of the budget ratio. Within the dead band between the budget and
+// HEADROOM below it the scale holds, and after every change it waits out the latency of the GPU timings, so it
+// does not oscillate on the results of frames rendered at the previous scale.
+class ResolutionController {
+public:
+	// fraction below the budget the frame has to drop before the scale goes up again
+	static constexpr float HEADROOM = 0.15f;
+	// largest change of the scale in one step
+	static constexpr float MAX_STEP = 0.1f;
+	// smaller corrections are not worth a visible change of sharpness
+	static constexpr float MIN_STEP = 0.02f;
+
+	float targetMs{ 1000.f / 60.f };
+	float minScale{ 0.5f };
+	float maxScale{ 1.f };
+
+	// latencyFrames is how many frames old the GPU timings are
+	void init(uint32_t latencyFrames);
+	void reset(float scale);
+
+	// takes the latest GPU frame time and returns the scale for the next frame, NaN times are ignored
+	float update(float gpuMs);
+	float scale() const { return current; }
+	float smoothedMs() const { return smoothed; }
+private:
+	float current{ 1.f };
+	float smoothed{ 0.f };
+	uint32_t latency{ 2 };
+	uint32_t cooldown{ 0 };
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// index and generation of a pooled value, a handle outliving its value no longer resolves instead of dangling
+template<typename T>
+struct ResourceHandle {
+	uint32_t slot{ UINT32_MAX };
+	uint32_t generation{ 0 };
+
+	// set at all, not necessarily still live
+	explicit operator bool() const { return slot != UINT32_MAX; }
+	bool operator==(const ResourceHandle& other) const { return slot == other.slot && generation == other.generation; }
+	bool operator!=(const ResourceHandle& other) const { return !(*this == other); }
+};
+
+// Values in one contiguous array addressed by handle. Releasing a value invalidates its handles at once, but the value
+// and its slot are kept until the frame timeline passes the value the release was tagged with, so frames in flight
+// recorded with it stay valid and a reused slot never aliases something the GPU still reads.
+template<typename T>
+class ResourcePool {
+public:
+	using Handle = ResourceHandle<T>;
+
+	Handle add(T value) {
+		uint32_t slot;
+		if (!freeSlots.empty()) {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+			values[slot] = std::move(value);
+		}
+		else {
+			slot = (uint32_t)values.size();
+			values.push_back(std::move(value));
+			generations.push_back(1);
+		}
+		live++;
+		return Handle{ slot, generations[slot] };
+	}
+
+	// no generation check outside debug builds, the caller holds a handle it knows to be live
+	T& get(Handle handle) {
+		assert(contains(handle));
+		return values[handle.slot];
+	}
+	const T& get(Handle handle) const {
+		assert(contains(handle));
+		return values[handle.slot];
+	}
+	bool contains(Handle handle) const {
+		return handle.slot < generations.size() && generations[handle.slot] == handle.generation;
+	}
+
+	// safeAfter is the timeline value of the last frame that may use the value, releases must not go back in time
+	void release(Handle handle, uint64_t safeAfter) {
+		if (!contains(handle)) {
+			return;
+		}
+		generations[handle.slot]++;
+		live--;
+		pending.push_back(Pending{ handle.slot, safeAfter });
+	}
+
+	// hands values the timeline has passed to destroy and recycles their slots
+	template<typename Destroy>
+	void collect(uint64_t completedValue, Destroy&& destroy) {
+		size_t count = 0;
+		while (count < pending.size() && pending[count].safeAfter <= completedValue) {
+			uint32_t slot = pending[count].slot;
+			destroy(values[slot]);
+			values[slot] = T{};
+			freeSlots.push_back(slot);
+			count++;
+		}
+		pending.erase(pending.begin(), pending.begin() + count);
+	}
+
+	size_t size() const { return live; }
+	// released values still waiting for the GPU
+	size_t pendingCount() const { return pending.size(); }
+private:
+	struct Pending {
+		uint32_t slot;
+		uint64_t safeAfter;
+	};
+
+	std::vector<T> values;
+	std::vector<uint32_t> generations;
+	std::vector<uint32_t> freeSlots;
+	std::vector<Pending> pending;
+	size_t live{ 0 };
+};
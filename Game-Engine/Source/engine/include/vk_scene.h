@@ -0,0 +1,56 @@
+#pragma once
+#include <vk_types.h>
+#include <vk_render_list.h>
+
+struct MeshAsset;
+struct AssetPools;
+
+namespace Core {
+	class ThreadPool;
+}
+
+// appends one render object per surface of the mesh
+void addMeshDraws(const MeshAsset& mesh, const AssetPools& assets, const glm::mat4& transform, DrawContext& ctx);
+
+// Flattened transform hierarchy. Nodes live in parallel arrays in breadth first order, so every parent comes
+// before its children and all nodes of one depth are contiguous. World transforms are recomputed level by level
+// in a linear pass that only touches the subtrees below nodes marked dirty.
+class SceneGraph {
+public:
+	static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+	// nodes must be added in breadth first order: the parent already added and no shallower than the last node's parent
+	uint32_t addNode(uint32_t parent, const glm::mat4& localTransform, MeshHandle mesh = {});
+	void clear();
+
+	void setLocalTransform(uint32_t node, const glm::mat4& localTransform);
+	const glm::mat4& worldTransform(uint32_t node) const { return worldTransforms[node]; }
+	uint32_t parent(uint32_t node) const { return parents[node]; }
+	size_t size() const { return parents.size(); }
+
+	// recomputes the world transforms below dirty nodes, levels wide enough are split across the pool
+	void updateTransforms(Core::ThreadPool* pool = nullptr);
+	// emits the surfaces of every mesh node, expects updated transforms
+	void draw(const AssetPools& assets, const glm::mat4& topMatrix, DrawContext& ctx) const;
+
+	// registers the surfaces of every mesh node with the list, updateTransforms then only forwards moved nodes
+	void addToRenderList(RenderList& list, const AssetPools& assets, const glm::mat4& topMatrix);
+	void removeFromRenderList();
+
+private:
+	std::vector<uint32_t> parents;
+	std::vector<glm::mat4> localTransforms;
+	std::vector<glm::mat4> worldTransforms;
+	std::vector<uint8_t> dirty;
+	std::vector<uint32_t> levelStarts;
+	// mesh nodes only, so drawing skips pure transform nodes
+	std::vector<uint32_t> meshNodes;
+	std::vector<MeshHandle> meshes;
+	bool anyDirty{ false };
+
+	RenderList* renderList{ nullptr };
+	glm::mat4 renderTransform;
+	// handles of mesh node k are renderHandles[renderRanges[k], renderRanges[k + 1])
+	std::vector<RenderHandle> renderHandles;
+	std::vector<uint32_t> renderRanges;
+};
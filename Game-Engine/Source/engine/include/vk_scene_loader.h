@@ -0,0 +1,48 @@
+#pragma once
+#include <vk_loader.h>
+#include <Core/Task.h>
+#include <chrono>
+
+// Loads glTF scenes without stalling the frame. Every load is a coroutine: parsing, image decoding and LOD and
+// meshlet generation run on the engine's thread pool, then the GPU upload is recorded a slice at a time on the render
+// thread, each slice awaiting its own timeline value through the engine's CompletionPoller instead of a blocking fence
+// wait. Loads run concurrently and one slice per load is recorded per frame. A scene is added to loadedScenes and the
+// render list only once all of it is resident, so it never draws with missing meshes or textures.
+class AsyncSceneLoader {
+public:
+	// staging bytes recorded per slice
+	static constexpr size_t SLICE_BYTES = 32ull << 20;
+
+	void init(VulkanEngine* engine);
+	// cancels the loads in progress, a load still parsing is waited for
+	void destroy();
+
+	// path is relative to the model root
+	void load(const std::string& name, const std::filesystem::path& path);
+	// blocks until every requested scene is loaded or has failed
+	void finish();
+
+	size_t pendingCount() const;
+private:
+	// a command buffer and the staging memory of one submitted step, reused once the GPU has passed it
+	struct Slice {
+		VkCommandBuffer cmd;
+		std::vector<AllocatedBuffer> staging;
+		bool busy{ false };
+	};
+
+	Core::Task<> loadScene(std::string name, std::filesystem::path path);
+	// records and submits one step of the upload, completes once the GPU has executed it with the step's result
+	Core::Task<bool> uploadSlice(GLTFUpload& upload);
+	Slice& acquireSlice();
+	void releaseSlice(Slice& slice);
+
+	VulkanEngine* engine{ nullptr };
+	VkCommandPool commandPool{ VK_NULL_HANDLE };
+	// signaled by every submitted slice
+	VkSemaphore timeline{ VK_NULL_HANDLE };
+	uint64_t submitted{ 0 };
+	bool stopping{ false };
+	std::vector<std::unique_ptr<Slice>> slices;
+	std::vector<Core::Task<>> loads;
+};
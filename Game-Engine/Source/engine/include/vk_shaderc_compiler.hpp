@@ -80,6 +80,8 @@ namespace shdc {
         if (ext == ".geom") return shaderc_geometry_shader;
         if (ext == ".tesc") return shaderc_tess_control_shader;
         if (ext == ".tese") return shaderc_tess_evaluation_shader;
+        if (ext == ".task") return shaderc_task_shader;
+        if (ext == ".mesh") return shaderc_mesh_shader;
         fmt::print("[I/O ERROR] could not recognize the extension of the shader {}\n", p.string());
 		abort();
     }
@@ -0,0 +1,21 @@
+#pragma once
+#include <vk_types.h>
+
+namespace drawsort {
+	struct Item {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	// Packs the draw state into a key whose order is the submission order:
+	// pass 1 | pipeline 3 | material 14 | index type 1 | geometry 28 | depth 17 (bits, high to low).
+	// Geometry sits above depth so repeated surfaces stay next to each other for instancing, and each
+	// geometry bucket is drawn front to back. Mesh ids follow upload order, which is also the geometry pool page
+	// order, so index buffer rebinds stay rare. Ids wider than their field wrap, which only costs batching.
+	uint64_t make_key(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t indexType, uint32_t geometry, float viewDepth);
+
+	// Stable LSD radix sort on the keys, 8 bits per pass. Passes where every key has the same digit are skipped,
+	// so sorting only costs as many passes as the frame has distinct state. scratch is resized as needed and can
+	// be kept between frames.
+	void radix_sort(std::vector<Item>& items, std::vector<Item>& scratch);
+}
@@ -12,6 +12,7 @@
 #include "vulkan/vulkan.h"
 #include "vulkan/vk_enum_string_helper.h"
 #include <vk_mem_alloc.h>
+#include <vk_resource_pool.h>
 #include <fmt/core.h>
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/mat4x4.hpp>
@@ -62,6 +63,12 @@ struct AllocatedBuffer {
 	VmaAllocationInfo allocInfo;
 };
 
+struct Bounds {
+	glm::vec3 origin;
+	float sphereRadius;
+	glm::vec3 extents;
+};
+
 struct Vertex {
 	glm::vec3 position;
 	float uv_x;
@@ -70,15 +77,63 @@ struct Vertex {
 	glm::vec4 color;
 };
 
+// a vertex and index range of the engine geometry pool
+struct GeometryAllocation {
+	uint32_t page{ UINT32_MAX };
+	VmaVirtualAllocation vertexAllocation{ VK_NULL_HANDLE };
+	VmaVirtualAllocation indexAllocation{ VK_NULL_HANDLE };
+	uint32_t firstVertex{ 0 };
+	VkDeviceSize indexOffset{ 0 }; // in bytes, always a multiple of 4
+};
+
 struct GPUMeshBuffers {
-	AllocatedBuffer indexBuffer;
-	AllocatedBuffer vertexBuffer;
+	uint32_t id; // upload order, used for draw sorting
+	GeometryAllocation geometry;
+	// shared pool buffers, not owned by the mesh
+	VkBuffer indexBuffer;
 	VkDeviceAddress vertexBufferAddress;
+	VkIndexType indexType;
+	// added to the mesh relative indices and vertices when drawing
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	AllocatedBuffer meshletBuffer;
+	VkDeviceAddress meshletBufferAddress;
 };
 
 struct GPUDrawPushConstants {
 	glm::mat4 worldMatrix;
 	VkDeviceAddress vertexBuffer;
+	// transforms of the instances in the draw, indexed by gl_InstanceIndex. worldMatrix is only read by the task/mesh path
+	VkDeviceAddress instanceBuffer;
+	// only read by the task/mesh shader path
+	VkDeviceAddress meshletBuffer;
+	VkDeviceAddress meshletData;
+	uint32_t meshletCount;
+};
+
+struct MeshletCullPushConstants {
+	glm::vec4 frustumPlanes[6];
+	glm::vec3 cameraPosition;
+	uint32_t jobCount;
+	VkDeviceAddress jobBuffer;
+	VkDeviceAddress commandBuffer;
+};
+
+// matches sharpen_upscale.comp, extents are read as ivec2
+struct UpscalePushConstants {
+	VkExtent2D sourceSize;
+	VkExtent2D targetSize;
+	float sharpness;
+};
+
+struct GPUMeshletCullJob {
+	glm::mat4 transform;
+	VkDeviceAddress meshlets;
+	uint32_t meshletCount;
+	uint32_t commandOffset;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t padding[2];
 };
 
 enum class MaterialPass :uint8_t {
@@ -86,16 +141,25 @@ enum class MaterialPass :uint8_t {
 };
 
 struct MaterialPipeline {
+	uint32_t sortId;
 	VkPipeline pipeline;
+	VkPipeline meshletPipeline;
 	VkPipelineLayout layout;
 };
 
 struct MaterialInstance {
+	uint32_t sortId;
 	MaterialPipeline* pipeline;
 	VkDescriptorSet materialSet;
 	MaterialPass passType;
 };
 
+struct MeshAsset;
+
+using MaterialHandle = ResourceHandle<MaterialInstance>;
+using MeshHandle = ResourceHandle<MeshAsset>;
+using ImageHandle = ResourceHandle<AllocatedImage>;
+
 struct DrawContext;
 
 class IRenderable {
@@ -110,7 +174,7 @@ struct Node : public IRenderable {
 
 	void refreshTransform(const glm::mat4& parentMatrix) {
 		worldTransform = parentMatrix * localTransform;
-		for (auto c : children) {
+		for (auto& c : children) {
 			c->refreshTransform(worldTransform);
 		}
 	}
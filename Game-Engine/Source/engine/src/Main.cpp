@@ -1,8 +1,52 @@
 #include <vk_engine.h>
-int main() {
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// --headless [frames] renders offscreen without a window, --capture <n> writes every n-th headless frame to PNG,
+// --benchmark <path> replays a camera path and writes frame times to --report <csv>, benchmark.csv by default,
+// at the fixed render scale --scale <0.25-1>, 1 by default,
+// --frames-in-flight <1-3> and --present fifo|mailbox|immediate trade latency against throughput
+int main(int argc, char* argv[]) {
 	VulkanEngine engine;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0) {
+			engine.headless = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				engine.headlessFrames = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			}
+		}
+		else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+			engine.captureInterval = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+			engine.benchmarkPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+			engine.benchmarkScale = std::clamp(std::strtof(argv[++i], nullptr), 0.25f, 1.f);
+		}
+		else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+			engine.benchmarkReport = argv[++i];
+		}
+		else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+			engine.framesInFlight = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--present") == 0 && i + 1 < argc) {
+			const char* mode = argv[++i];
+			if (strcmp(mode, "mailbox") == 0) {
+				engine.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+			}
+			else if (strcmp(mode, "immediate") == 0) {
+				engine.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			}
+			else {
+				engine.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+			}
+		}
+	}
+
 	engine.init();
 	engine.run();
 	engine.cleanup();
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,170 @@
+#include <benchmark.h>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+	struct Summary {
+		float p50, p95, p99, max, mean;
+		size_t count;
+	};
+
+	// nearest rank percentiles over the values that are not NaN
+	Summary summarize(std::vector<float> values) {
+		values.erase(std::remove_if(values.begin(), values.end(), [](float v) { return std::isnan(v); }), values.end());
+		Summary s{};
+		s.count = values.size();
+		if (values.empty()) {
+			return s;
+		}
+		std::sort(values.begin(), values.end());
+		auto rank = [&](float p) { return values[std::clamp<size_t>((size_t)std::ceil(p * values.size()), 1, values.size()) - 1]; };
+		s.p50 = rank(0.50f);
+		s.p95 = rank(0.95f);
+		s.p99 = rank(0.99f);
+		s.max = values.back();
+		double sum = 0.0;
+		for (float v : values) {
+			sum += v;
+		}
+		s.mean = (float)(sum / values.size());
+		return s;
+	}
+}
+
+bool CameraPath::load(const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		return false;
+	}
+	keyframes.clear();
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		Keyframe k;
+		if (sscanf(line.c_str(), "%f %f %f %f %f %f", &k.time, &k.position.x, &k.position.y, &k.position.z, &k.pitch, &k.yaw) == 6) {
+			keyframes.push_back(k);
+		}
+	}
+	return !keyframes.empty();
+}
+
+bool CameraPath::save(const std::string& path) const {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+	file << "# time x y z pitch yaw\n";
+	for (const Keyframe& k : keyframes) {
+		file << fmt::format("{:.4f} {:.4f} {:.4f} {:.4f} {:.5f} {:.5f}\n", k.time, k.position.x, k.position.y, k.position.z, k.pitch, k.yaw);
+	}
+	return (bool)file;
+}
+
+CameraPath::Keyframe CameraPath::sample(float time) const {
+	if (time <= keyframes.front().time) {
+		return keyframes.front();
+	}
+	if (time >= keyframes.back().time) {
+		return keyframes.back();
+	}
+	auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](float t, const Keyframe& k) { return t < k.time; });
+	const Keyframe& a = *(next - 1);
+	const Keyframe& b = *next;
+	float f = (time - a.time) / std::max(b.time - a.time, 1e-6f);
+
+	Keyframe k;
+	k.time = time;
+	k.position = a.position + (b.position - a.position) * f;
+	k.pitch = a.pitch + (b.pitch - a.pitch) * f;
+	k.yaw = a.yaw + (b.yaw - a.yaw) * f;
+	return k;
+}
+
+bool CameraBenchmark::load(const std::string& file, float timestep, uint32_t gpuLatency) {
+	if (!path.load(file)) {
+		return false;
+	}
+	this->timestep = timestep;
+	this->gpuLatency = gpuLatency;
+	recordedFrames = (uint32_t)std::floor(path.duration() / timestep) + 1;
+	frame = 0;
+	samples.assign(recordedFrames, FrameSample{ 0.f, 0.f, NAN, 0, 0 });
+	return true;
+}
+
+bool CameraBenchmark::beginFrame(Camera& camera) {
+	if (frame >= WARMUP_FRAMES + recordedFrames + gpuLatency) {
+		return false;
+	}
+	int64_t index = std::clamp<int64_t>((int64_t)frame - WARMUP_FRAMES, 0, recordedFrames - 1);
+	CameraPath::Keyframe pose = path.sample(index * timestep);
+	camera.position = pose.position;
+	camera.pitch = pose.pitch;
+	camera.yaw = pose.yaw;
+	camera.velocity = glm::vec3(0.f);
+	return true;
+}
+
+void CameraBenchmark::endFrame(float frameMs, float cpuMs, float gpuMs, int triangles, int draws) {
+	int64_t index = (int64_t)frame - WARMUP_FRAMES;
+	if (index >= 0 && index < recordedFrames) {
+		FrameSample& s = samples[index];
+		s.frameMs = frameMs;
+		s.cpuMs = cpuMs;
+		s.triangles = triangles;
+		s.draws = draws;
+	}
+	int64_t gpuIndex = index - gpuLatency;
+	if (gpuIndex >= 0 && gpuIndex < recordedFrames) {
+		samples[gpuIndex].gpuMs = gpuMs;
+	}
+	frame++;
+}
+
+bool CameraBenchmark::writeReport(const std::string& csvPath) const {
+	std::ofstream csv(csvPath, std::ios::trunc);
+	if (!csv.is_open()) {
+		fmt::print("[I/O ERROR]: could not write benchmark report to {}\n", csvPath);
+		return false;
+	}
+	csv << "frame,time,frame_ms,cpu_ms,gpu_ms,triangles,draws\n";
+	std::vector<float> frameMs, cpuMs, gpuMs;
+	for (uint32_t i = 0; i < samples.size(); i++) {
+		const FrameSample& s = samples[i];
+		csv << fmt::format("{},{:.4f},{:.4f},{:.4f},", i, i * timestep, s.frameMs, s.cpuMs);
+		if (!std::isnan(s.gpuMs)) {
+			csv << fmt::format("{:.4f}", s.gpuMs);
+		}
+		csv << fmt::format(",{},{}\n", s.triangles, s.draws);
+		frameMs.push_back(s.frameMs);
+		cpuMs.push_back(s.cpuMs);
+		gpuMs.push_back(s.gpuMs);
+	}
+
+	std::string summary = fmt::format("{} frames at {:.4f} s steps\n", samples.size(), timestep);
+	auto line = [&](const char* name, const std::vector<float>& values) {
+		Summary s = summarize(values);
+		if (s.count == 0) {
+			summary += fmt::format("{:<6} n/a\n", name);
+			return s;
+		}
+		summary += fmt::format("{:<6} p50 {:8.3f}  p95 {:8.3f}  p99 {:8.3f}  max {:8.3f}  mean {:8.3f} ms\n", name, s.p50, s.p95, s.p99, s.max, s.mean);
+		return s;
+	};
+	Summary frameSummary = line("frame", frameMs);
+	line("cpu", cpuMs);
+	line("gpu", gpuMs);
+
+	size_t hitches = std::count_if(frameMs.begin(), frameMs.end(), [&](float v) { return v > frameSummary.p50 * HITCH_FACTOR; });
+	summary += fmt::format("hitches {} (frames over {:.1f}x the median)\n", hitches, HITCH_FACTOR);
+
+	std::filesystem::path summaryPath = std::filesystem::path(csvPath).replace_extension(".txt");
+	std::ofstream summaryFile(summaryPath, std::ios::trunc);
+	summaryFile << summary;
+
+	fmt::print("[CONSOLE INFO]: benchmark report written to {} and {}\n{}", csvPath, summaryPath.string(), summary);
+	return (bool)csv && (bool)summaryFile;
+}
@@ -0,0 +1,103 @@
+#include "vk_barriers.h"
+#include "vk_initializers.h"
+
+namespace {
+	VkImageAspectFlags aspect_for(VkImageLayout layout) {
+		switch (layout) {
+		case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+}
+
+ImageState imagestate::from_layout(VkImageLayout layout) {
+	switch (layout) {
+	case VK_IMAGE_LAYOUT_GENERAL: return COMPUTE_STORAGE;
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return COLOR_ATTACHMENT;
+	case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL: return DEPTH_ATTACHMENT;
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return TRANSFER_SRC;
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return TRANSFER_DST;
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return SHADER_READ;
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return PRESENT;
+	case VK_IMAGE_LAYOUT_UNDEFINED: return UNDEFINED;
+	default:
+		// unknown layouts keep the old full barrier
+		return ImageState{ layout, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT };
+	}
+}
+
+void BarrierTracker::setState(VkImage image, const ImageState& state, VkImageAspectFlags aspect) {
+	images[image] = Tracked{ state, aspect };
+}
+
+void BarrierTracker::transition(VkImage image, const ImageState& state, bool discard) {
+	auto [it, inserted] = images.try_emplace(image, Tracked{ imagestate::UNDEFINED, aspect_for(state.layout) });
+	Tracked& tracked = it->second;
+	ImageState& current = tracked.state;
+
+	const bool writes = ((current.access | state.access) & imagestate::WRITE_ACCESS) != 0;
+	if (current.layout == state.layout && !writes && !discard) {
+		// later writers have to wait for both readers
+		current.stages |= state.stages;
+		current.access |= state.access;
+		return;
+	}
+
+	VkImageMemoryBarrier2 barrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+	barrier.srcStageMask = current.stages;
+	// reads never have to be made available, only ordered
+	barrier.srcAccessMask = current.access & imagestate::WRITE_ACCESS;
+	barrier.dstStageMask = state.stages;
+	barrier.dstAccessMask = state.access;
+	barrier.oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : current.layout;
+	barrier.newLayout = state.layout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = vkinit::image_subresource_range(tracked.aspect);
+
+	// an image already waiting in this batch is merged, the barrier keeps its old source and takes the new target
+	for (VkImageMemoryBarrier2& p : pending) {
+		if (p.image == image) {
+			p.dstStageMask = barrier.dstStageMask;
+			p.dstAccessMask = barrier.dstAccessMask;
+			p.newLayout = barrier.newLayout;
+			if (discard) {
+				p.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+			current = state;
+			return;
+		}
+	}
+
+	pending.push_back(barrier);
+	current = state;
+}
+
+void BarrierTracker::flush(VkCommandBuffer cmd) {
+	if (pending.empty()) {
+		return;
+	}
+
+	VkDependencyInfo depInfo{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+	depInfo.imageMemoryBarrierCount = (uint32_t)pending.size();
+	depInfo.pImageMemoryBarriers = pending.data();
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+
+	flushes++;
+	barriers += (uint32_t)pending.size();
+	pending.clear();
+}
+
+void BarrierTracker::forget(VkImage image) {
+	images.erase(image);
+	std::erase_if(pending, [&](const VkImageMemoryBarrier2& b) { return b.image == image; });
+}
+
+const ImageState& BarrierTracker::state(VkImage image) const {
+	auto it = images.find(image);
+	return it != images.end() ? it->second.state : imagestate::UNDEFINED;
+}
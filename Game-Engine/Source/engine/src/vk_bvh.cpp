@@ -0,0 +1,385 @@
+#include "vk_bvh.h"
+#include <cassert>
+#include <cfloat>
+#include <glm/common.hpp>
+
+namespace {
+	constexpr uint32_t SAH_BINS = 16;
+	// leaves are made at or below this size, and larger ones only when no split is cheaper
+	constexpr uint32_t MIN_LEAF_SIZE = 2;
+	constexpr uint32_t MAX_LEAF_SIZE = 16;
+	// relative cost of visiting a node against testing one item
+	constexpr float TRAVERSAL_COST = 1.f;
+	// bounds the traversal stacks, deeper nodes become leaves whatever their size
+	constexpr uint32_t MAX_DEPTH = 64;
+
+	AABB empty_box() {
+		return AABB{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+	}
+
+	void grow(AABB& box, const AABB& other) {
+		box.min = glm::min(box.min, other.min);
+		box.max = glm::max(box.max, other.max);
+	}
+
+	float half_area(const AABB& box) {
+		glm::vec3 e = glm::max(box.max - box.min, glm::vec3(0.f));
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	AABB object_box(const culling::BoundsSoA& bounds, uint32_t i) {
+		glm::vec3 c{ bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i] };
+		glm::vec3 e{ bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i] };
+		return AABB{ c - e, c + e };
+	}
+
+	// partitioned in place during the build so every node reads its items sequentially
+	struct BuildItem {
+		AABB box;
+		glm::vec3 centroid;
+		uint32_t object;
+	};
+
+	enum class PlaneTest { OUTSIDE, INTERSECTING, INSIDE };
+
+	PlaneTest test_planes(const glm::vec3& min, const glm::vec3& max, const glm::vec4 planes[6]) {
+		glm::vec3 c = (min + max) * 0.5f;
+		glm::vec3 e = (max - min) * 0.5f;
+		PlaneTest result = PlaneTest::INSIDE;
+		for (int p = 0; p < 6; p++) {
+			float d = c.x * planes[p].x + c.y * planes[p].y + c.z * planes[p].z + planes[p].w;
+			float r = e.x * std::abs(planes[p].x) + e.y * std::abs(planes[p].y) + e.z * std::abs(planes[p].z);
+			if (d + r < 0.f) {
+				return PlaneTest::OUTSIDE;
+			}
+			if (d - r < 0.f) {
+				result = PlaneTest::INTERSECTING;
+			}
+		}
+		return result;
+	}
+
+	bool overlaps(const glm::vec3& min, const glm::vec3& max, const AABB& box) {
+		return min.x <= box.max.x && max.x >= box.min.x
+			&& min.y <= box.max.y && max.y >= box.min.y
+			&& min.z <= box.max.z && max.z >= box.min.z;
+	}
+
+	// slab test, returns the entry distance or FLT_MAX on a miss
+	float intersect_ray(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& invDir, float maxDistance) {
+		glm::vec3 t0 = (min - origin) * invDir;
+		glm::vec3 t1 = (max - origin) * invDir;
+		glm::vec3 tmin = glm::min(t0, t1);
+		glm::vec3 tmax = glm::max(t0, t1);
+		float enter = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.f));
+		float exit = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, maxDistance));
+		return enter <= exit ? enter : FLT_MAX;
+	}
+}
+
+void BVH::build(const culling::BoundsSoA& bounds) {
+	const uint32_t count = (uint32_t)bounds.count;
+	clear();
+	if (count == 0) {
+		return;
+	}
+
+	std::vector<BuildItem> buildItems(count);
+	for (uint32_t i = 0; i < count; i++) {
+		buildItems[i].box = object_box(bounds, i);
+		buildItems[i].centroid = (buildItems[i].box.min + buildItems[i].box.max) * 0.5f;
+		buildItems[i].object = i;
+	}
+
+	nodes.reserve(2 * count / MIN_LEAF_SIZE + 1);
+	nodes.push_back(Node{ {}, 0, {}, count, 0, UINT32_MAX });
+
+	struct Task {
+		uint32_t node;
+		uint32_t depth;
+	};
+	std::vector<Task> stack{ { 0, 1 } };
+	while (!stack.empty()) {
+		const Task task = stack.back();
+		const uint32_t nodeIndex = task.node;
+		stack.pop_back();
+		const uint32_t first = nodes[nodeIndex].firstItem;
+		const uint32_t n = nodes[nodeIndex].itemCount;
+
+		AABB box = empty_box();
+		AABB centroidBox = empty_box();
+		for (uint32_t i = first; i < first + n; i++) {
+			grow(box, buildItems[i].box);
+			grow(centroidBox, AABB{ buildItems[i].centroid, buildItems[i].centroid });
+		}
+		nodes[nodeIndex].min = box.min;
+		nodes[nodeIndex].max = box.max;
+
+		if (n <= MIN_LEAF_SIZE || task.depth == MAX_DEPTH) {
+			continue;
+		}
+
+		// cheapest bin boundary over all three axes, small nodes use fewer bins as the per bin sweep dominates there
+		const uint32_t binCount = std::min(SAH_BINS, n);
+		int bestAxis = -1;
+		uint32_t bestSplit = 0;
+		float bestCost = FLT_MAX;
+		for (int axis = 0; axis < 3; axis++) {
+			const float lo = centroidBox.min[axis];
+			const float extent = centroidBox.max[axis] - lo;
+			if (extent <= 0.f) {
+				continue;
+			}
+			const float scale = binCount / extent;
+
+			AABB binBoxes[SAH_BINS];
+			uint32_t binCounts[SAH_BINS] = {};
+			for (uint32_t b = 0; b < binCount; b++) {
+				binBoxes[b] = empty_box();
+			}
+			for (uint32_t i = first; i < first + n; i++) {
+				uint32_t bin = std::min(uint32_t((buildItems[i].centroid[axis] - lo) * scale), binCount - 1);
+				binCounts[bin]++;
+				grow(binBoxes[bin], buildItems[i].box);
+			}
+
+			// right to left sweep stores the cost of everything right of each boundary
+			float rightCost[SAH_BINS];
+			AABB acc = empty_box();
+			uint32_t accCount = 0;
+			for (uint32_t b = binCount - 1; b > 0; b--) {
+				grow(acc, binBoxes[b]);
+				accCount += binCounts[b];
+				rightCost[b] = accCount > 0 ? half_area(acc) * accCount : 0.f;
+			}
+			acc = empty_box();
+			accCount = 0;
+			for (uint32_t b = 0; b < binCount - 1; b++) {
+				grow(acc, binBoxes[b]);
+				accCount += binCounts[b];
+				float cost = half_area(acc) * accCount + rightCost[b + 1];
+				if (accCount > 0 && accCount < n && cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b + 1;
+				}
+			}
+		}
+
+		const float leafCost = half_area(box) * n;
+		if (bestAxis < 0 || (n <= MAX_LEAF_SIZE && bestCost + TRAVERSAL_COST * half_area(box) >= leafCost)) {
+			continue;
+		}
+
+		const float lo = centroidBox.min[bestAxis];
+		const float scale = binCount / (centroidBox.max[bestAxis] - lo);
+		BuildItem* mid = std::partition(buildItems.data() + first, buildItems.data() + first + n, [&](const BuildItem& item) {
+			return std::min(uint32_t((item.centroid[bestAxis] - lo) * scale), binCount - 1) < bestSplit;
+			});
+		const uint32_t leftCount = uint32_t(mid - (buildItems.data() + first));
+
+		const uint32_t left = (uint32_t)nodes.size();
+		nodes[nodeIndex].left = left;
+		nodes.push_back(Node{ {}, first, {}, leftCount, 0, nodeIndex });
+		nodes.push_back(Node{ {}, first + leftCount, {}, n - leftCount, 0, nodeIndex });
+		stack.push_back({ left, task.depth + 1 });
+		stack.push_back({ left + 1, task.depth + 1 });
+	}
+
+	items.resize(count);
+	itemBounds.resize(count);
+	itemOf.resize(count);
+	leafOf.resize(count);
+	for (uint32_t n = 0; n < nodes.size(); n++) {
+		if (nodes[n].left != 0) {
+			continue;
+		}
+		for (uint32_t i = nodes[n].firstItem; i < nodes[n].firstItem + nodes[n].itemCount; i++) {
+			items[i] = buildItems[i].object;
+			itemBounds[i] = buildItems[i].box;
+			itemOf[items[i]] = i;
+			leafOf[i] = n;
+		}
+	}
+
+	builtCost = sahCost();
+}
+
+void BVH::refit(const culling::BoundsSoA& bounds) {
+	assert(bounds.count == items.size());
+	for (uint32_t i = 0; i < items.size(); i++) {
+		itemBounds[i] = object_box(bounds, items[i]);
+	}
+	// children always come after their parent
+	for (uint32_t n = (uint32_t)nodes.size(); n-- > 0;) {
+		refitNode(n);
+	}
+}
+
+void BVH::refit(const culling::BoundsSoA& bounds, std::span<const uint32_t> moved) {
+	for (uint32_t object : moved) {
+		const uint32_t i = itemOf[object];
+		itemBounds[i] = object_box(bounds, object);
+		for (uint32_t n = leafOf[i]; n != UINT32_MAX; n = nodes[n].parent) {
+			refitNode(n);
+		}
+	}
+}
+
+void BVH::clear() {
+	nodes.clear();
+	items.clear();
+	itemBounds.clear();
+	itemOf.clear();
+	leafOf.clear();
+	builtCost = 0.f;
+}
+
+void BVH::refitNode(uint32_t n) {
+	Node& node = nodes[n];
+	AABB box = empty_box();
+	if (node.left != 0) {
+		grow(box, AABB{ nodes[node.left].min, nodes[node.left].max });
+		grow(box, AABB{ nodes[node.left + 1].min, nodes[node.left + 1].max });
+	}
+	else {
+		for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+			grow(box, itemBounds[i]);
+		}
+	}
+	node.min = box.min;
+	node.max = box.max;
+}
+
+void BVH::cull(const glm::vec4 planes[6], std::vector<uint32_t>& visible) const {
+	if (nodes.empty()) {
+		return;
+	}
+
+	uint32_t stack[MAX_DEPTH + 1];
+	uint32_t top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = nodes[stack[--top]];
+		PlaneTest test = test_planes(node.min, node.max, planes);
+		if (test == PlaneTest::OUTSIDE) {
+			continue;
+		}
+		if (test == PlaneTest::INSIDE) {
+			visible.insert(visible.end(), items.begin() + node.firstItem, items.begin() + node.firstItem + node.itemCount);
+			continue;
+		}
+		if (node.left != 0) {
+			stack[top++] = node.left;
+			stack[top++] = node.left + 1;
+			continue;
+		}
+		for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+			if (test_planes(itemBounds[i].min, itemBounds[i].max, planes) != PlaneTest::OUTSIDE) {
+				visible.push_back(items[i]);
+			}
+		}
+	}
+}
+
+void BVH::queryBox(const AABB& box, std::vector<uint32_t>& result) const {
+	if (nodes.empty()) {
+		return;
+	}
+
+	uint32_t stack[MAX_DEPTH + 1];
+	uint32_t top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = nodes[stack[--top]];
+		if (!overlaps(node.min, node.max, box)) {
+			continue;
+		}
+		if (node.left != 0) {
+			stack[top++] = node.left;
+			stack[top++] = node.left + 1;
+			continue;
+		}
+		for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+			if (overlaps(itemBounds[i].min, itemBounds[i].max, box)) {
+				result.push_back(items[i]);
+			}
+		}
+	}
+}
+
+uint32_t BVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* hitDistance) const {
+	uint32_t hit = UINT32_MAX;
+	if (nodes.empty()) {
+		return hit;
+	}
+
+	const glm::vec3 invDir = 1.f / direction;
+	float nearest = maxDistance;
+
+	struct Entry {
+		uint32_t node;
+		float distance;
+	};
+	Entry stack[MAX_DEPTH + 1];
+	uint32_t top = 0;
+	float rootDistance = intersect_ray(nodes[0].min, nodes[0].max, origin, invDir, nearest);
+	if (rootDistance != FLT_MAX) {
+		stack[top++] = { 0, rootDistance };
+	}
+
+	while (top > 0) {
+		Entry e = stack[--top];
+		// a closer hit was found since this node was pushed
+		if (e.distance > nearest) {
+			continue;
+		}
+		const Node& node = nodes[e.node];
+		if (node.left == 0) {
+			for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+				float t = intersect_ray(itemBounds[i].min, itemBounds[i].max, origin, invDir, nearest);
+				if (t != FLT_MAX && (hit == UINT32_MAX || t < nearest)) {
+					nearest = t;
+					hit = items[i];
+				}
+			}
+			continue;
+		}
+
+		// the nearer child goes on top of the stack and is visited first
+		float dl = intersect_ray(nodes[node.left].min, nodes[node.left].max, origin, invDir, nearest);
+		float dr = intersect_ray(nodes[node.left + 1].min, nodes[node.left + 1].max, origin, invDir, nearest);
+		Entry l{ node.left, dl };
+		Entry r{ node.left + 1, dr };
+		if (dl < dr) {
+			std::swap(l, r);
+		}
+		if (l.distance != FLT_MAX) {
+			stack[top++] = l;
+		}
+		if (r.distance != FLT_MAX) {
+			stack[top++] = r;
+		}
+	}
+
+	if (hitDistance != nullptr && hit != UINT32_MAX) {
+		*hitDistance = nearest;
+	}
+	return hit;
+}
+
+float BVH::degradation() const {
+	return builtCost > 0.f ? sahCost() / builtCost : 1.f;
+}
+
+float BVH::sahCost() const {
+	if (nodes.empty()) {
+		return 0.f;
+	}
+	float cost = 0.f;
+	for (const Node& node : nodes) {
+		float area = half_area(AABB{ node.min, node.max });
+		cost += node.left != 0 ? TRAVERSAL_COST * area : area * node.itemCount;
+	}
+	return cost / std::max(half_area(AABB{ nodes[0].min, nodes[0].max }), FLT_MIN);
+}
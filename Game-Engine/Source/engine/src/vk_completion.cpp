@@ -0,0 +1,61 @@
+#include <vk_completion.h>
+
+void CompletionPoller::init(VkDevice device) {
+	this->device = device;
+}
+
+void CompletionPoller::enqueue(const Waiter& waiter) {
+	std::lock_guard lock(mutex);
+	waiters.push_back(waiter);
+}
+
+void CompletionPoller::poll() {
+	{
+		std::lock_guard lock(mutex);
+		std::swap(waiters, polled);
+	}
+
+	// a semaphore queried once per poll, waiters on one timeline are usually grouped
+	VkSemaphore lastSemaphore = VK_NULL_HANDLE;
+	uint64_t lastValue = 0;
+	size_t kept = 0;
+	for (const Waiter& waiter : polled) {
+		bool signaled = true;
+		if (waiter.fence != VK_NULL_HANDLE) {
+			signaled = vkGetFenceStatus(device, waiter.fence) == VK_SUCCESS;
+		}
+		else if (waiter.semaphore != VK_NULL_HANDLE) {
+			if (waiter.semaphore != lastSemaphore) {
+				VK_CHECK(vkGetSemaphoreCounterValue(device, waiter.semaphore, &lastValue));
+				lastSemaphore = waiter.semaphore;
+			}
+			signaled = lastValue >= waiter.value;
+		}
+
+		if (signaled) {
+			ready.push_back(waiter.handle);
+		}
+		else {
+			polled[kept++] = waiter;
+		}
+	}
+	polled.resize(kept);
+
+	// put back ahead of anything enqueued meanwhile, so waiters keep their order
+	{
+		std::lock_guard lock(mutex);
+		polled.insert(polled.end(), waiters.begin(), waiters.end());
+		std::swap(waiters, polled);
+		polled.clear();
+	}
+
+	for (std::coroutine_handle<> handle : ready) {
+		handle.resume();
+	}
+	ready.clear();
+}
+
+size_t CompletionPoller::pending() const {
+	std::lock_guard lock(mutex);
+	return waiters.size();
+}
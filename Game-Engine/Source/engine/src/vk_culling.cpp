@@ -0,0 +1,174 @@
+#include "vk_culling.h"
+#include <Core/ThreadPool.h>
+#include <bit>
+#include <cfloat>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+	constexpr size_t SIMD_WIDTH = 8;
+	// objects per worker task, below this the list is culled on the calling thread alone
+	constexpr size_t CULL_GRAIN = 16384;
+
+	void cull_range(const culling::BoundsSoA& b, const glm::vec4 planes[6], size_t begin, size_t end, std::vector<uint32_t>& out) {
+		// sized for the worst case up front so the hot loop writes without capacity checks
+		const size_t first = out.size();
+		out.resize(first + (end - begin));
+		uint32_t* write = out.data() + first;
+#if defined(__AVX2__)
+		__m256 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+		for (int p = 0; p < 6; p++) {
+			nx[p] = _mm256_set1_ps(planes[p].x);
+			ny[p] = _mm256_set1_ps(planes[p].y);
+			nz[p] = _mm256_set1_ps(planes[p].z);
+			nw[p] = _mm256_set1_ps(planes[p].w);
+			ax[p] = _mm256_set1_ps(std::abs(planes[p].x));
+			ay[p] = _mm256_set1_ps(std::abs(planes[p].y));
+			az[p] = _mm256_set1_ps(std::abs(planes[p].z));
+		}
+		const __m256 zero = _mm256_setzero_ps();
+
+		for (size_t i = begin; i < end; i += SIMD_WIDTH) {
+			__m256 cx = _mm256_loadu_ps(&b.centerX[i]);
+			__m256 cy = _mm256_loadu_ps(&b.centerY[i]);
+			__m256 cz = _mm256_loadu_ps(&b.centerZ[i]);
+			__m256 ex = _mm256_loadu_ps(&b.extentX[i]);
+			__m256 ey = _mm256_loadu_ps(&b.extentY[i]);
+			__m256 ez = _mm256_loadu_ps(&b.extentZ[i]);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				// signed distance of the centre plus the box extent projected on the plane normal
+				__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, nx[p]), _mm256_mul_ps(cy, ny[p])), _mm256_add_ps(_mm256_mul_ps(cz, nz[p]), nw[p]));
+				__m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, ax[p]), _mm256_mul_ps(ey, ay[p])), _mm256_mul_ps(ez, az[p]));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_GE_OQ));
+			}
+
+			uint32_t mask = (uint32_t)_mm256_movemask_ps(inside);
+			while (mask != 0) {
+				*write++ = (uint32_t)(i + std::countr_zero(mask));
+				mask &= mask - 1;
+			}
+		}
+#else
+		for (size_t i = begin; i < end; i++) {
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++) {
+				float d = b.centerX[i] * planes[p].x + b.centerY[i] * planes[p].y + b.centerZ[i] * planes[p].z + planes[p].w;
+				float r = b.extentX[i] * std::abs(planes[p].x) + b.extentY[i] * std::abs(planes[p].y) + b.extentZ[i] * std::abs(planes[p].z);
+				inside = d + r >= 0.f;
+			}
+			*write = (uint32_t)i;
+			write += inside ? 1 : 0;
+		}
+#endif
+		out.resize(write - out.data());
+	}
+}
+
+void culling::BoundsSoA::resize(size_t n) {
+	const size_t padded = (n + SIMD_WIDTH - 1) & ~(SIMD_WIDTH - 1);
+	for (std::vector<float>* v : { &centerX, &centerY, &centerZ }) {
+		v->resize(padded);
+		std::fill(v->begin() + n, v->end(), 0.f);
+	}
+	// negative extents put the padding outside of every plane
+	for (std::vector<float>* v : { &extentX, &extentY, &extentZ }) {
+		v->resize(padded);
+		std::fill(v->begin() + n, v->end(), -FLT_MAX);
+	}
+	count = n;
+}
+
+void culling::BoundsSoA::set(size_t index, const Bounds& bounds, const glm::mat4& transform) {
+	glm::vec3 center = glm::vec3(transform * glm::vec4(bounds.origin, 1.f));
+	glm::vec3 extent = glm::abs(glm::vec3(transform[0])) * bounds.extents.x
+		+ glm::abs(glm::vec3(transform[1])) * bounds.extents.y
+		+ glm::abs(glm::vec3(transform[2])) * bounds.extents.z;
+
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	extentX[index] = extent.x;
+	extentY[index] = extent.y;
+	extentZ[index] = extent.z;
+}
+
+void culling::extract_planes(const glm::mat4& viewproj, glm::vec4 planes[6]) {
+	// valid for the reversed [0, 1] depth range as both depth planes are kept
+	glm::mat4 rows = glm::transpose(viewproj);
+	planes[0] = rows[3] + rows[0];
+	planes[1] = rows[3] - rows[0];
+	planes[2] = rows[3] + rows[1];
+	planes[3] = rows[3] - rows[1];
+	planes[4] = rows[2];
+	planes[5] = rows[3] - rows[2];
+	for (int i = 0; i < 6; i++) {
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
+
+void culling::cull(const BoundsSoA& bounds, const glm::vec4 planes[6], std::vector<uint32_t>& visible, Core::ThreadPool* pool) {
+	const size_t padded = bounds.centerX.size();
+	const size_t rangeCount = (padded + CULL_GRAIN - 1) / CULL_GRAIN;
+
+	if (pool == nullptr || rangeCount <= 1) {
+		cull_range(bounds, planes, 0, padded, visible);
+		return;
+	}
+
+	// every range keeps its own list so the merged result stays ordered
+	std::vector<std::vector<uint32_t>> ranges(rangeCount);
+	pool->ParallelFor(padded, CULL_GRAIN, [&](size_t begin, size_t end) {
+		std::vector<uint32_t>& out = ranges[begin / CULL_GRAIN];
+		cull_range(bounds, planes, begin, end, out);
+		});
+
+	for (const std::vector<uint32_t>& r : ranges) {
+		visible.insert(visible.end(), r.begin(), r.end());
+	}
+}
+
+bool culling::is_visible(const Bounds& bounds, const glm::mat4& transform, const glm::mat4& viewproj) {
+	std::array<glm::vec3, 8> corners{
+		glm::vec3 { 1, 1, 1 },
+		glm::vec3 { 1, 1, -1 },
+		glm::vec3 { 1, -1, 1 },
+		glm::vec3 { 1, -1, -1 },
+		glm::vec3 { -1, 1, 1 },
+		glm::vec3 { -1, 1, -1 },
+		glm::vec3 { -1, -1, 1 },
+		glm::vec3 { -1, -1, -1 },
+	};
+
+	glm::mat4 matrix = viewproj * transform;
+
+	glm::vec3 min = { 1.5, 1.5, 1.5 };
+	glm::vec3 max = { -1.5, -1.5, -1.5 };
+
+	for (int c = 0; c < 8; c++) {
+		// project each corner into clip space
+		glm::vec4 v = matrix * glm::vec4(bounds.origin + (corners[c] * bounds.extents), 1.f);
+
+		// perspective correction
+		v.x = v.x / v.w;
+		v.y = v.y / v.w;
+		v.z = v.z / v.w;
+
+		min = glm::min(glm::vec3{ v.x, v.y, v.z }, min);
+		max = glm::max(glm::vec3{ v.x, v.y, v.z }, max);
+	}
+
+	// check the clip space box is within the view
+	if (min.z > 1.f || max.z < 0.f || min.x > 1.f || max.x < -1.f || min.y > 1.f || max.y < -1.f) {
+		return false;
+	}
+	else {
+		return true;
+	}
+}
@@ -0,0 +1,81 @@
+#include <vk_deletion.h>
+
+void TypedDeletionQueue::init(VkDevice device, VmaAllocator allocator) {
+	this->device = device;
+	this->allocator = allocator;
+}
+
+void TypedDeletionQueue::destroyBuffer(const AllocatedBuffer& buffer, uint64_t safeAfter) {
+	buffers.push(buffer.buffer, safeAfter);
+	allocations.push(buffer.allocation, safeAfter);
+}
+
+void TypedDeletionQueue::destroyImage(const AllocatedImage& image, uint64_t safeAfter) {
+	views.push(image.imageView, safeAfter);
+	images.push(image.image, safeAfter);
+	allocations.push(image.allocation, safeAfter);
+}
+
+void TypedDeletionQueue::destroyImage(VkImage image, uint64_t safeAfter) {
+	images.push(image, safeAfter);
+}
+
+void TypedDeletionQueue::destroyImageView(VkImageView view, uint64_t safeAfter) {
+	views.push(view, safeAfter);
+}
+
+void TypedDeletionQueue::destroySampler(VkSampler sampler, uint64_t safeAfter) {
+	samplers.push(sampler, safeAfter);
+}
+
+void TypedDeletionQueue::destroyDescriptorPool(VkDescriptorPool pool, uint64_t safeAfter) {
+	pools.push(pool, safeAfter);
+}
+
+void TypedDeletionQueue::freeMemory(VmaAllocation allocation, uint64_t safeAfter) {
+	allocations.push(allocation, safeAfter);
+}
+
+void TypedDeletionQueue::collect(uint64_t completedValue) {
+	size_t count = views.ready(completedValue);
+	for (size_t i = 0; i < count; i++) {
+		vkDestroyImageView(device, views.handles[i], nullptr);
+	}
+	views.drop(count);
+
+	count = samplers.ready(completedValue);
+	for (size_t i = 0; i < count; i++) {
+		vkDestroySampler(device, samplers.handles[i], nullptr);
+	}
+	samplers.drop(count);
+
+	count = pools.ready(completedValue);
+	for (size_t i = 0; i < count; i++) {
+		vkDestroyDescriptorPool(device, pools.handles[i], nullptr);
+	}
+	pools.drop(count);
+
+	count = buffers.ready(completedValue);
+	for (size_t i = 0; i < count; i++) {
+		vkDestroyBuffer(device, buffers.handles[i], nullptr);
+	}
+	buffers.drop(count);
+
+	count = images.ready(completedValue);
+	for (size_t i = 0; i < count; i++) {
+		vkDestroyImage(device, images.handles[i], nullptr);
+	}
+	images.drop(count);
+
+	// null allocations are skipped by VMA
+	count = allocations.ready(completedValue);
+	if (count > 0) {
+		vmaFreeMemoryPages(allocator, count, allocations.handles.data());
+	}
+	allocations.drop(count);
+}
+
+size_t TypedDeletionQueue::pending() const {
+	return views.handles.size() + samplers.handles.size() + pools.handles.size() + buffers.handles.size()
+		+ images.handles.size() + allocations.handles.size();
+}
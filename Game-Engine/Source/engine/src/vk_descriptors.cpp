@@ -143,6 +143,21 @@ void DynamicDescriptorAllocator::destroyPools(VkDevice device) {
 	fullPools.clear();
 }
 
+void DynamicDescriptorAllocator::destroyPools(TypedDeletionQueue& deletion, uint64_t safeAfter) {
+	if (currentPool != VK_NULL_HANDLE) {
+		deletion.destroyDescriptorPool(currentPool, safeAfter);
+		currentPool = VK_NULL_HANDLE;
+	}
+	for (auto p : readyPools) {
+		deletion.destroyDescriptorPool(p, safeAfter);
+	}
+	readyPools.clear();
+	for (auto p : fullPools) {
+		deletion.destroyDescriptorPool(p, safeAfter);
+	}
+	fullPools.clear();
+}
+
 VkDescriptorSet DynamicDescriptorAllocator::allocate(VkDevice device, VkDescriptorSetLayout layout, void* pNext) {
 	if(currentPool == VK_NULL_HANDLE){
 		currentPool = getPool(device);
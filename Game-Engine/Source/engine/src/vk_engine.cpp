@@ -5,6 +5,7 @@
 #include "vk_images.h"
 #include "vk_loader.h"
 #include "vk_descriptors.h"
+#include "vk_culling.h"
 
 #include <SDL.h>
 #include <SDL_vulkan.h>
@@ -19,6 +20,10 @@
 
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/gtx/transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
 
 #include "vk_mem_alloc.h"
 
@@ -36,18 +41,22 @@ VulkanEngine& VulkanEngine::get() { return *loadedEngine; }
 void VulkanEngine::init() {
 	assert(loadedEngine == nullptr);
 	loadedEngine = this;
-
-	SDL_Init(SDL_INIT_VIDEO);
-	SDL_WindowFlags windowFlags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
-
-	window = SDL_CreateWindow(
-		"Vulkan Engine",
-		SDL_WINDOWPOS_UNDEFINED,
-		SDL_WINDOWPOS_UNDEFINED,
-		windowExtent.width,
-		windowExtent.height,
-		windowFlags
-	);
+	CORE_PROFILE_THREAD("main");
+	framesInFlight = std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+
+	if (!headless) {
+		SDL_Init(SDL_INIT_VIDEO);
+		SDL_WindowFlags windowFlags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
+
+		window = SDL_CreateWindow(
+			"Vulkan Engine",
+			SDL_WINDOWPOS_UNDEFINED,
+			SDL_WINDOWPOS_UNDEFINED,
+			windowExtent.width,
+			windowExtent.height,
+			windowFlags
+		);
+	}
 
 	initVulkan();
 	initSwapchain();
@@ -55,7 +64,9 @@ void VulkanEngine::init() {
 	initSyncStructures();
 	initDescriptors();
 	initPipelines();
-	initImGui();
+	if (!headless) {
+		initImGui();
+	}
 	init_default_data();
 
 	camera.velocity = glm::vec3(0.f);
@@ -65,93 +76,255 @@ void VulkanEngine::init() {
 
 	isInitialized = true;
 
-	std::string structurePath = { "structure.glb" };
-	std::string scenePath = { "scene/source/Untitled.glb" };
-	auto structureFile = load_gltf(this, scenePath);
-
-	assert(structureFile.has_value());
+	// static, registered once and drawn from the retained list every frame. The structure joins the list once loaded
+	DrawContext suzanneDraws;
+	loadedNodes["Suzanne"]->Draw(glm::mat4{ 1.f }, suzanneDraws);
+	renderList.add(suzanneDraws);
+
+	completions.init(driver);
+	sceneLoader.init(this);
+	sceneLoader.load("structure", "scene/source/Untitled.glb");
+	// captures and replays compare frames, so they start with the scene complete
+	if (headless || !benchmarkPath.empty()) {
+		sceneLoader.finish();
+	}
 
-	loadedScenes["structure"] = *structureFile;
+	if (!benchmarkPath.empty()) {
+		if (benchmark.load(benchmarkPath, benchmarkTimestep, framesInFlight)) {
+			fmt::print("[CONSOLE INFO]: replaying camera path {}\n", benchmarkPath);
+		}
+		else {
+			fmt::print("[I/O ERROR]: could not read camera path {}, running without it\n", benchmarkPath);
+		}
+	}
 }
 
 
 void VulkanEngine::cleanup() {
 	if (isInitialized) {
+#if CORE_PROFILING
+		writeTrace();
+#endif
 		vkDeviceWaitIdle(driver);
 
+		sceneLoader.destroy();
+		// nothing may stay suspended on the device being destroyed
+		assert(completions.pending() == 0);
+		renderList.clear();
 		loadedScenes.clear();
 		metalRoughMat.clearResources(driver);
 
-		for (int i = 0; i < FRAME_OVERLAP; i++) {
+		vkDestroySemaphore(driver, frameTimeline, nullptr);
+		for (uint32_t i = 0; i < framesInFlight; i++) {
 			vkDestroyCommandPool(driver, frames[i].commandPool, nullptr);
 
-			vkDestroyFence(driver, frames[i].renderFence, nullptr);
-			vkDestroySemaphore(driver, frames[i].renderSemaphore, nullptr);
 			vkDestroySemaphore(driver, frames[i].swapchainSemaphore, nullptr);
 			frames[i].deletionQueue.flush();
+
+			if (frames[i].meshletJobCapacity > 0) {
+				destroyBuffer(frames[i].meshletJobBuffer);
+			}
+			if (frames[i].meshletCommandCapacity > 0) {
+				destroyBuffer(frames[i].meshletCommandBuffer);
+			}
+			if (frames[i].instanceCapacity > 0) {
+				destroyBuffer(frames[i].instanceBuffer);
+			}
+			if (frames[i].readbackCapacity > 0) {
+				destroyBuffer(frames[i].readbackBuffer);
+			}
 		}
 		mainDeletionQueue.flush();
-		destroySwapchain();
-		vkDestroySurfaceKHR(instance, surface, nullptr);
+		if (!headless) {
+			for (const RetiredSwapchain& retired : retiredSwapchains) {
+				destroyRetiredSwapchain(retired);
+			}
+			retiredSwapchains.clear();
+			destroySwapchain();
+			vkDestroySurfaceKHR(instance, surface, nullptr);
+		}
 		vkDestroyDevice(driver, nullptr);
 		vkb::destroy_debug_utils_messenger(instance, debugMessenger);
 		vkDestroyInstance(instance, nullptr);
-		SDL_DestroyWindow(window);
+		if (!headless) {
+			SDL_DestroyWindow(window);
+		}
 	}
 	loadedEngine = nullptr;
 }
 
 
 void VulkanEngine::draw() {
+	CORE_PROFILE_FUNCTION();
+	collectLatency();
+	auto inputTime = std::chrono::system_clock::now();
+	// resumes coroutines whose GPU work or frame hop is due, which is where loaded scenes get published
+	completions.poll();
 	updateScene();
-	VK_CHECK(vkWaitForFences(driver, 1, &get_current_frame().renderFence, true, UINT64_MAX));
+	auto waitStart = std::chrono::system_clock::now();
+	// the frame that last used this slot signaled frameNumber + 1 - framesInFlight, slots not used yet wait for 0
+	VkSemaphoreWaitInfo waitInfo = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &frameTimeline;
+	waitInfo.pValues = &get_current_frame().timelineValue;
+	VK_CHECK(vkWaitSemaphores(driver, &waitInfo, UINT64_MAX));
+	stats.fence_wait_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - waitStart).count() / 1000.f;
+	collectLatency();
+	// other slots may have completed too, everything the timeline has passed can go
+	uint64_t completedValue;
+	VK_CHECK(vkGetSemaphoreCounterValue(driver, frameTimeline, &completedValue));
+	deferredDeletion.collect(completedValue);
+	collectAssets(completedValue);
+	get_current_frame().arena.Reset();
 	get_current_frame().deletionQueue.flush();
 	get_current_frame().descriptorAllocator.clearPools(driver);
-	uint32_t swapchainImageIndex;
-	VkResult resize = vkAcquireNextImageKHR(driver, swapchain, UINT64_MAX, get_current_frame().swapchainSemaphore, nullptr, &swapchainImageIndex);
-	if (resize == VK_ERROR_OUT_OF_DATE_KHR || resize == VK_SUBOPTIMAL_KHR) {
-		resizeRequest = true;
-		return;
+	if (get_current_frame().captureFrame >= 0) {
+		writeCapture(get_current_frame());
 	}
-	drawExtent.height = std::min(swapchainExtent.height, drawImage.imageExtent.height) * renderScale;
-	drawExtent.width = std::min(swapchainExtent.width, drawImage.imageExtent.width) * renderScale;
 
-	VK_CHECK(vkResetFences(driver, 1, &get_current_frame().renderFence));
+	uint32_t swapchainImageIndex = 0;
+	VkExtent2D targetExtent = windowExtent;
+	if (!headless) {
+		VkResult resize = vkAcquireNextImageKHR(driver, swapchain, UINT64_MAX, get_current_frame().swapchainSemaphore, nullptr, &swapchainImageIndex);
+		if (resize == VK_ERROR_OUT_OF_DATE_KHR) {
+			resizeRequest = true;
+			return;
+		}
+		// a suboptimal image was still acquired and its semaphore will signal, so the frame is drawn before recreating
+		if (resize == VK_SUBOPTIMAL_KHR) {
+			resizeRequest = true;
+		}
+		targetExtent = swapchainExtent;
+	}
+	// a replay measures one fixed resolution, headless or not
+	if (benchmark.active()) {
+		renderScale = benchmarkScale;
+	}
+	else if (!headless && dynamicResolution && gpuProfiler.enabled()) {
+		renderScale = resolution.update(gpuProfiler.frame().lastMs);
+	}
+	drawExtent.height = std::min(targetExtent.height, drawImage.imageExtent.height) * renderScale;
+	drawExtent.width = std::min(targetExtent.width, drawImage.imageExtent.width) * renderScale;
+
 	VK_CHECK(vkResetCommandBuffer(get_current_frame().commandBuffer, 0));
 	VkCommandBuffer cmd = get_current_frame().commandBuffer;
 	VkCommandBufferBeginInfo beginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);	
 	VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+	gpuProfiler.beginFrame(cmd, frameNumber % framesInFlight);
+	barriers.resetCounters();
+
+	renderGraph.reset();
+	RenderGraph::Resource color = renderGraph.importImage("color", drawImage.image, drawImage.imageView);
+	RenderGraph::Resource depth = renderGraph.importImage("depth", depthImage.image, depthImage.imageView);
+
+	// the draw and depth images are fully rewritten every frame, so their old contents are discarded
+	renderGraph.addPass("background", [&](RenderGraph::PassBuilder& pass) {
+		pass.write(color, imagestate::COMPUTE_STORAGE, true);
+		}, [this](VkCommandBuffer cmd) {
+			drawBackground(cmd);
+		});
 
-	vkutil::transition_image(cmd, drawImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-
-	drawBackground(cmd);
-
-	vkutil::transition_image(cmd, drawImage.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-	vkutil::transition_image(cmd, depthImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
-
-	drawMesh(cmd);
-
-	vkutil::transition_image(cmd, drawImage.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-
-	vkutil::transition_image(cmd, swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	renderGraph.addPass("geometry", [&](RenderGraph::PassBuilder& pass) {
+		pass.write(color, imagestate::COLOR_ATTACHMENT);
+		pass.write(depth, imagestate::DEPTH_ATTACHMENT, true);
+		}, [this](VkCommandBuffer cmd) {
+			drawMesh(cmd);
+		});
 
-	vkutil::copy_image_to_image(cmd, drawImage.image, swapchainImages[swapchainImageIndex], drawExtent, swapchainExtent);
+	if (headless) {
+		renderGraph.setFinalState(color, imagestate::TRANSFER_SRC);
+		if (captureInterval > 0 && (frameNumber + 1) % captureInterval == 0) {
+			renderGraph.addPass("capture", [&](RenderGraph::PassBuilder& pass) {
+				pass.read(color, imagestate::TRANSFER_SRC);
+				pass.sideEffects();
+				}, [this](VkCommandBuffer cmd) {
+					FrameData& frame = get_current_frame();
+					reserveFrameBuffer(frame.readbackBuffer, frame.readbackCapacity, drawExtent.width * drawExtent.height, sizeof(uint16_t) * 4,
+						VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU, 0);
+
+					VkBufferImageCopy region = {};
+					region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+					region.imageSubresource.layerCount = 1;
+					region.imageExtent = { drawExtent.width, drawExtent.height, 1 };
+					vkCmdCopyImageToBuffer(cmd, drawImage.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, frame.readbackBuffer.buffer, 1, &region);
+
+					VkMemoryBarrier2 hostBarrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+					hostBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+					hostBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+					hostBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+					hostBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+					VkDependencyInfo dependency = { .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+					dependency.memoryBarrierCount = 1;
+					dependency.pMemoryBarriers = &hostBarrier;
+					vkCmdPipelineBarrier2(cmd, &dependency);
+
+					frame.captureFrame = frameNumber;
+					frame.captureExtent = drawExtent;
+				});
+		}
+	}
+	else {
+		VkImage swapchainImage = swapchainImages[swapchainImageIndex];
+		// the acquire semaphore is waited on at the blit, which is the first use of the swapchain image
+		barriers.setState(swapchainImage, ImageState{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_NONE });
+		RenderGraph::Resource backbuffer = renderGraph.importImage("swapchain", swapchainImage, swapchainImageViews[swapchainImageIndex]);
+		renderGraph.setFinalState(backbuffer, imagestate::PRESENT);
+
+		// the blit then copies the upscaled image one to one, only converting the format
+		RenderGraph::Resource presented = color;
+		VkExtent2D presentedExtent = drawExtent;
+		if (sharpenUpscale && (drawExtent.width != swapchainExtent.width || drawExtent.height != swapchainExtent.height)) {
+			presented = renderGraph.createImage("upscaled", { VK_FORMAT_R16G16B16A16_SFLOAT, swapchainExtent, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT });
+			presentedExtent = swapchainExtent;
+			renderGraph.addPass("sharpen upscale", [&](RenderGraph::PassBuilder& pass) {
+				pass.read(color, imagestate::COMPUTE_STORAGE);
+				pass.write(presented, imagestate::COMPUTE_STORAGE, true);
+				}, [this, presented](VkCommandBuffer cmd) {
+					drawUpscale(cmd, renderGraph.view(presented));
+				});
+		}
 
-	vkutil::transition_image(cmd, swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		renderGraph.addPass("present blit", [&](RenderGraph::PassBuilder& pass) {
+			pass.read(presented, imagestate::TRANSFER_SRC);
+			pass.write(backbuffer, imagestate::TRANSFER_DST, true);
+			}, [this, presented, presentedExtent, swapchainImage](VkCommandBuffer cmd) {
+				vkutil::copy_image_to_image(cmd, renderGraph.image(presented), swapchainImage, presentedExtent, swapchainExtent);
+			});
 
-	drawImGui(cmd, swapchainImageViews[swapchainImageIndex]);
+		renderGraph.addPass("imgui", [&](RenderGraph::PassBuilder& pass) {
+			pass.write(backbuffer, imagestate::COLOR_ATTACHMENT);
+			}, [this, swapchainImageIndex](VkCommandBuffer cmd) {
+				drawImGui(cmd, swapchainImageViews[swapchainImageIndex]);
+			});
+	}
 
-	vkutil::transition_image(cmd, swapchainImages[swapchainImageIndex], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	renderGraph.compile(deferredDeletion, barriers, (uint64_t)frameNumber + 1);
+	renderGraph.execute(cmd, barriers, &gpuProfiler);
 
 	VK_CHECK(vkEndCommandBuffer(cmd));
 
+	FrameData& frame = get_current_frame();
+	frame.timelineValue = (uint64_t)frameNumber + 1;
+	frame.inputTime = inputTime;
+	frame.latencyPending = true;
+
 	VkCommandBufferSubmitInfo cmdInfo = vkinit::command_buffer_submit_info(cmd);
-	VkSemaphoreSubmitInfo waitInfo = vkinit::semaphore_submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, get_current_frame().swapchainSemaphore);
-	VkSemaphoreSubmitInfo signalInfo = vkinit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, get_current_frame().renderSemaphore);
-	VkSubmitInfo2 submit = vkinit::submit_info(&cmdInfo, &signalInfo, &waitInfo);
+	VkSemaphoreSubmitInfo signalInfos[2];
+	signalInfos[0] = vkinit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frameTimeline);
+	signalInfos[0].value = frame.timelineValue;
+	if (headless) {
+		VkSubmitInfo2 submit = vkinit::submit_info(&cmdInfo, signalInfos, nullptr);
+		VK_CHECK(vkQueueSubmit2(graphicsQueue, 1, &submit, VK_NULL_HANDLE));
+		frameNumber++;
+		return;
+	}
+
+	VkSemaphoreSubmitInfo acquireInfo = vkinit::semaphore_submit_info(VK_PIPELINE_STAGE_2_TRANSFER_BIT, frame.swapchainSemaphore);
+	signalInfos[1] = vkinit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, presentSemaphores[swapchainImageIndex]);
+	VkSubmitInfo2 submit = vkinit::submit_info(&cmdInfo, signalInfos, &acquireInfo);
+	submit.signalSemaphoreInfoCount = 2;
 
-	VK_CHECK(vkQueueSubmit2(graphicsQueue, 1, &submit, get_current_frame().renderFence));
+	VK_CHECK(vkQueueSubmit2(graphicsQueue, 1, &submit, VK_NULL_HANDLE));
 
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -159,49 +332,93 @@ void VulkanEngine::draw() {
 	presentInfo.pSwapchains = &swapchain;
 	presentInfo.swapchainCount = 1;
 
-	presentInfo.pWaitSemaphores = &get_current_frame().renderSemaphore;
+	presentInfo.pWaitSemaphores = &presentSemaphores[swapchainImageIndex];
 	presentInfo.waitSemaphoreCount = 1;
 
 	presentInfo.pImageIndices = &swapchainImageIndex;
 
-	resize = vkQueuePresentKHR(graphicsQueue, &presentInfo);
+	VkResult resize = vkQueuePresentKHR(graphicsQueue, &presentInfo);
 	
 	if (resize == VK_ERROR_OUT_OF_DATE_KHR || resize == VK_SUBOPTIMAL_KHR) {
 		resizeRequest = true;
 	}
 
+	// presents are processed in queue order, so once every image of the current swapchain has been presented the old
+	// present semaphores are no longer waited on. They go to this frame's queue, flushed after it has completed
+	if (resize == VK_SUCCESS || resize == VK_SUBOPTIMAL_KHR) {
+		for (size_t i = 0; i < retiredSwapchains.size();) {
+			if (--retiredSwapchains[i].presentsLeft > 0) {
+				i++;
+				continue;
+			}
+			get_current_frame().deletionQueue.push_function([this, retired = std::move(retiredSwapchains[i])]() {
+				destroyRetiredSwapchain(retired);
+				});
+			retiredSwapchains.erase(retiredSwapchains.begin() + i);
+		}
+	}
+
 	frameNumber++;
 }
 
 
 void VulkanEngine::run() {
+	if (headless) {
+		runHeadless();
+		return;
+	}
+
 	SDL_Event event;
 	bool bQuit = false;
 	bool fps = false;
 
 	while (!bQuit) {
+		CORE_PROFILE_SCOPE("frame");
 		auto start = std::chrono::system_clock::now();
 
 		while (SDL_PollEvent(&event) != 0) {
 			if (event.type == SDL_QUIT) bQuit = true;
 			if (event.type == SDL_WINDOWEVENT) {
-				if (event.type == SDL_WINDOWEVENT_MINIMIZED) {
+				if (event.window.event == SDL_WINDOWEVENT_MINIMIZED) {
 					stopRendering = true;
 				}
-				if (event.type == SDL_WINDOWEVENT_RESTORED) {
+				if (event.window.event == SDL_WINDOWEVENT_RESTORED) {
 					stopRendering = false;
+				}
+				// not every platform reports an out of date swapchain on resize
+				if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+					resizeRequest = true;
 				}	
 			}
 
 			if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE) {
 				bQuit = true;
 			}
+			if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F11) {
+				fullscreen = !fullscreen;
+				SDL_SetWindowFullscreen(window, fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0);
+			}
 			if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_p) {
 				fps = !fps;
 				SDL_SetRelativeMouseMode(fps ? SDL_TRUE : SDL_FALSE);
 			}
+			if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F9 && !benchmark.active()) {
+				recordingPath = !recordingPath;
+				if (recordingPath) {
+					recordedPath.clear();
+					recordingTime = 0.f;
+				}
+				else if (recordedPath.save("camera_path.txt")) {
+					fmt::print("[CONSOLE INFO]: camera path of {:.1f} s written to camera_path.txt\n", recordedPath.duration());
+				}
+			}
+#if CORE_PROFILING
+			if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F12) {
+				writeTrace();
+			}
+#endif
 
-			if (fps) camera.processSDLEvents(event);
+			if (fps && !benchmark.active()) camera.processSDLEvents(event);
 			ImGui_ImplSDL2_ProcessEvent(&event);
 		}
 
@@ -212,8 +429,11 @@ void VulkanEngine::run() {
 
 		if (resizeRequest) {
 			resizeSwapchain();
-			fmt::print("[CONSOLE INFO]: Resized to {}, {}\n", windowExtent.width, windowExtent.height);
-			resizeRequest = false;
+		}
+
+		if (benchmark.active() && !benchmark.beginFrame(camera)) {
+			bQuit = true;
+			continue;
 		}
 
 		ImGui_ImplVulkan_NewFrame();
@@ -227,6 +447,35 @@ void VulkanEngine::run() {
 		ImGui::Text("update time %f ms", stats.scene_update_time);
 		ImGui::Text("triangles %i", stats.triangle_count);
 		ImGui::Text("draws %i", stats.drawcall_count);
+		ImGui::Text("input latency %.2f ms (%u frames in flight, %s)", stats.input_latency, framesInFlight, string_VkPresentModeKHR(presentMode));
+		if (gpuProfiler.enabled()) {
+			const GpuProfiler::ScopeStats& gpuFrame = gpuProfiler.frame();
+			ImGui::Text("gpu frame %.2f ms (avg %.2f, p99 %.2f)", gpuFrame.lastMs, gpuFrame.averageMs, gpuFrame.p99Ms);
+			for (const GpuProfiler::ScopeStats& scope : gpuProfiler.results()) {
+				ImGui::Text("  %s %.2f ms (avg %.2f, p99 %.2f)", scope.name.c_str(), scope.lastMs, scope.averageMs, scope.p99Ms);
+			}
+		}
+		ImGui::Text("barriers %u in %u calls", barriers.barrierCount(), barriers.flushCount());
+		ImGui::Text("passes %zu, %zu culled", renderGraph.passCount(), renderGraph.culledPassCount());
+		ImGui::Text("transient images %.1f MB (%.1f MB unaliased)", renderGraph.transientBytes() / (1024.f * 1024.f), renderGraph.unaliasedBytes() / (1024.f * 1024.f));
+		ImGui::Text("geometry pool %.1f / %.1f MB", geometryPool.usedBytes() / (1024.f * 1024.f), geometryPool.capacityBytes() / (1024.f * 1024.f));
+		ImGui::SliderFloat("lod bias", &lodBias, 0.25f, 4.f);
+		if (ImGui::Checkbox("dynamic resolution", &dynamicResolution) && dynamicResolution) {
+			resolution.reset(renderScale);
+		}
+		if (benchmark.active()) {
+			ImGui::Text("render scale %.2f (fixed for the replay)", renderScale);
+		}
+		else if (dynamicResolution && gpuProfiler.enabled()) {
+			ImGui::SliderFloat("gpu budget ms", &resolution.targetMs, 4.f, 33.f);
+			ImGui::SliderFloat("min scale", &resolution.minScale, 0.25f, 1.f);
+			ImGui::Text("render scale %.2f (gpu %.2f ms)", renderScale, resolution.smoothedMs());
+		}
+		else {
+			ImGui::SliderFloat("render scale", &renderScale, 0.25f, 1.f);
+		}
+		ImGui::Checkbox("sharpen upscale", &sharpenUpscale);
+		ImGui::SliderFloat("sharpness", &sharpness, 0.f, 1.f);
 		ImGui::End();
 		
 		ImGui::Render();
@@ -237,6 +486,11 @@ void VulkanEngine::run() {
 
 		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
 		stats.frametime = elapsed.count() / 1000.f;
+		recordBenchmarkFrame();
+	}
+
+	if (benchmark.active()) {
+		benchmark.writeReport(benchmarkReport);
 	}
 }
 
@@ -244,16 +498,20 @@ void VulkanEngine::run() {
 void VulkanEngine::initVulkan() {
 	vkb::InstanceBuilder instanceBuilder;
 
+	// headless leaves out the surface extensions, so it also runs on software drivers such as lavapipe with no display
 	auto instanceReticle = instanceBuilder.set_app_name("Vulkan Game Engine")
 		.request_validation_layers(useValidationLayers)
 		.use_default_debug_messenger()
 		.require_api_version(1, 3, 0)
+		.set_headless(headless)
 		.build();
 	vkb::Instance vkbInstance = instanceReticle.value();
 	instance = vkbInstance.instance;
 	debugMessenger = vkbInstance.debug_messenger;
 
-	SDL_Vulkan_CreateSurface(window, instance, &surface);
+	if (!headless) {
+		SDL_Vulkan_CreateSurface(window, instance, &surface);
+	}
 	VkPhysicalDeviceVulkan13Features features{
 		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES
 	};
@@ -265,14 +523,27 @@ void VulkanEngine::initVulkan() {
 	};
 	features12.bufferDeviceAddress = true;
 	features12.descriptorIndexing = true;
+	features12.timelineSemaphore = true;
+
+	VkPhysicalDeviceFeatures features10 = {};
+	features10.multiDrawIndirect = true;
 
 	vkb::PhysicalDeviceSelector selector{ vkbInstance };
-	vkb::PhysicalDevice physicalDevice = selector.set_minimum_version(1, 3)
+	selector.set_minimum_version(1, 3)
+		.set_required_features(features10)
 		.set_required_features_12(features12)
-		.set_required_features_13(features)
-		.set_surface(surface)
-		.select()
-		.value();
+		.set_required_features_13(features);
+	if (!headless) {
+		selector.set_surface(surface);
+	}
+	vkb::PhysicalDevice physicalDevice = selector.select().value();
+
+	VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT };
+	meshShaderFeatures.taskShader = true;
+	meshShaderFeatures.meshShader = true;
+	meshShaderSupported = physicalDevice.is_extension_present(VK_EXT_MESH_SHADER_EXTENSION_NAME)
+		&& physicalDevice.enable_extension_features_if_present(meshShaderFeatures)
+		&& physicalDevice.enable_extension_if_present(VK_EXT_MESH_SHADER_EXTENSION_NAME);
 
 	vkb::DeviceBuilder deviceBuilder{ physicalDevice };
 	vkb::Device device = deviceBuilder.build().value();
@@ -283,6 +554,12 @@ void VulkanEngine::initVulkan() {
 	graphicsQueue = device.get_queue(vkb::QueueType::graphics).value();
 	graphicsQueueFamily = device.get_queue_index(vkb::QueueType::graphics).value();
 
+	if (meshShaderSupported) {
+		cmdDrawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(driver, "vkCmdDrawMeshTasksEXT");
+		geometryStages |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+	}
+	fmt::print("[CONSOLE INFO]: mesh shaders {}\n", meshShaderSupported ? "enabled" : "unavailable, culling meshlets in compute");
+
 	VmaAllocatorCreateInfo allocatorInfo = {};
 	allocatorInfo.physicalDevice = chosenGPU;
 	allocatorInfo.device = driver;
@@ -293,12 +570,44 @@ void VulkanEngine::initVulkan() {
 	mainDeletionQueue.push_function([&]() {
 		vmaDestroyAllocator(allocator);
 	});
+
+	deferredDeletion.init(driver, allocator);
+
+	mainDeletionQueue.push_function([&]() {
+		deferredDeletion.flush();
+	});
+
+	// 1M vertices (48 MB) and 32 MB of indices per page
+	geometryPool.init(driver, allocator, 1 << 20, 32 << 20);
+
+	mainDeletionQueue.push_function([&]() {
+		geometryPool.destroy();
+	});
+
+	// released assets still waiting for their frames, mesh ranges go back to the geometry pool before it is destroyed
+	mainDeletionQueue.push_function([&]() {
+		collectAssets(UINT64_MAX);
+	});
+
+	renderGraph.init(driver, allocator);
+
+	mainDeletionQueue.push_function([&]() {
+		renderGraph.destroy(barriers);
+	});
+
+	gpuProfiler.init(driver, chosenGPU, graphicsQueueFamily, framesInFlight);
+	// the scale chosen for a frame shows up in the timings framesInFlight frames later
+	resolution.init(framesInFlight);
+
+	mainDeletionQueue.push_function([&]() {
+		gpuProfiler.destroy();
+	});
 }
 
 
 void VulkanEngine::initCommands() {
 	VkCommandPoolCreateInfo commandPoolInfo = vkinit::command_pool_create_info(graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
-	for (int i = 0; i < FRAME_OVERLAP; i++) {
+	for (uint32_t i = 0; i < framesInFlight; i++) {
 
 		VK_CHECK(vkCreateCommandPool(driver, &commandPoolInfo, nullptr, &frames[i].commandPool));
 
@@ -320,10 +629,25 @@ void VulkanEngine::initCommands() {
 
 
 void VulkanEngine::initSwapchain() {
-	createSwapchain(windowExtent.width, windowExtent.height);
+	if (!headless) {
+		createSwapchain(windowExtent.width, windowExtent.height);
+	}
+	createRenderTargets(windowExtent);
+
+	// the targets may be replaced on resize, so the ones current at exit are destroyed
+	mainDeletionQueue.push_function([this]() {
+		vkDestroyImageView(driver, drawImage.imageView, nullptr);
+		vmaDestroyImage(allocator, drawImage.image, drawImage.allocation);
+		vkDestroyImageView(driver, depthImage.imageView, nullptr);
+		vmaDestroyImage(allocator, depthImage.image, depthImage.allocation);
+		});
+}
+
+
+void VulkanEngine::createRenderTargets(VkExtent2D extent) {
 	VkExtent3D drawImageExtent = {
-		windowExtent.width,
-		windowExtent.height,
+		extent.width,
+		extent.height,
 		1
 	};
 
@@ -356,22 +680,28 @@ void VulkanEngine::initSwapchain() {
 
 	VkImageViewCreateInfo dviewInfo = vkinit::imageview_create_info(depthImage.imageFormat, depthImage.image, VK_IMAGE_ASPECT_DEPTH_BIT);
 	VK_CHECK(vkCreateImageView(driver, &dviewInfo, nullptr, &depthImage.imageView));
-
-	mainDeletionQueue.push_function([=]() {
-		vkDestroyImageView(driver, drawImage.imageView, nullptr);
-		vmaDestroyImage(allocator, drawImage.image, drawImage.allocation);
-		vkDestroyImageView(driver, depthImage.imageView, nullptr);
-		vmaDestroyImage(allocator, depthImage.image, depthImage.allocation);
-		});
 }
 
 
 void VulkanEngine::createSwapchain(uint32_t width, uint32_t height) {
 	vkb::SwapchainBuilder swapchainBuilder{ chosenGPU, driver, surface };
 	swapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+
+	// FIFO is the only mode every surface supports
+	uint32_t modeCount = 0;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(chosenGPU, surface, &modeCount, nullptr);
+	std::vector<VkPresentModeKHR> modes(modeCount);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(chosenGPU, surface, &modeCount, modes.data());
+	if (std::find(modes.begin(), modes.end(), presentMode) == modes.end()) {
+		fmt::print("[CONSOLE INFO]: present mode {} unsupported, using FIFO\n", string_VkPresentModeKHR(presentMode));
+		presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	}
+
+	// the old swapchain, if any, lets the driver hand its resources over to the new one
 	vkb::Swapchain vkbSwapchain = swapchainBuilder
+		.set_old_swapchain(swapchain)
 		.set_desired_format(VkSurfaceFormatKHR{ .format = swapchainImageFormat, .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR })
-		.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
+		.set_desired_present_mode(presentMode)
 		.set_desired_extent(width, height)
 		.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
 		.build()
@@ -380,26 +710,54 @@ void VulkanEngine::createSwapchain(uint32_t width, uint32_t height) {
 	swapchain = vkbSwapchain.swapchain;
 	swapchainImages = vkbSwapchain.get_images().value();
 	swapchainImageViews = vkbSwapchain.get_image_views().value();
+
+	VkSemaphoreCreateInfo semaphoreInfo = vkinit::semaphore_create_info();
+	presentSemaphores.resize(swapchainImages.size());
+	for (VkSemaphore& semaphore : presentSemaphores) {
+		VK_CHECK(vkCreateSemaphore(driver, &semaphoreInfo, nullptr, &semaphore));
+	}
 }
 
 
+void VulkanEngine::destroyRetiredSwapchain(const RetiredSwapchain& retired) {
+	for (VkImageView view : retired.views) {
+		vkDestroyImageView(driver, view, nullptr);
+	}
+	for (VkSemaphore semaphore : retired.presentSemaphores) {
+		vkDestroySemaphore(driver, semaphore, nullptr);
+	}
+	vkDestroySwapchainKHR(driver, retired.swapchain, nullptr);
+}
+
 void VulkanEngine::destroySwapchain() {
+	for (VkImage image : swapchainImages) {
+		barriers.forget(image);
+	}
 	vkDestroySwapchainKHR(driver, swapchain, nullptr);
 	for (int i = 0; i < swapchainImageViews.size(); i++) {
 		vkDestroyImageView(driver, swapchainImageViews[i], nullptr);
 	}
+	for (VkSemaphore semaphore : presentSemaphores) {
+		vkDestroySemaphore(driver, semaphore, nullptr);
+	}
+	presentSemaphores.clear();
 }
 
 
 void VulkanEngine::initSyncStructures() {
 	VkFenceCreateInfo fenceInfo = vkinit::fence_create_info(VK_FENCE_CREATE_SIGNALED_BIT);
 	VkSemaphoreCreateInfo semaphoreInfo = vkinit::semaphore_create_info();
-	for (int i = 0; i < FRAME_OVERLAP; i++) {
-		VK_CHECK(vkCreateFence(driver, &fenceInfo, nullptr, &frames[i].renderFence));
-		VK_CHECK(vkCreateSemaphore(driver, &semaphoreInfo, nullptr, &frames[i].renderSemaphore));
+	for (uint32_t i = 0; i < framesInFlight; i++) {
 		VK_CHECK(vkCreateSemaphore(driver, &semaphoreInfo, nullptr, &frames[i].swapchainSemaphore));
 	}
 
+	VkSemaphoreTypeCreateInfo timelineInfo = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+	timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineInfo.initialValue = 0;
+	VkSemaphoreCreateInfo timelineSemaphoreInfo = vkinit::semaphore_create_info();
+	timelineSemaphoreInfo.pNext = &timelineInfo;
+	VK_CHECK(vkCreateSemaphore(driver, &timelineSemaphoreInfo, nullptr, &frameTimeline));
+
 	VK_CHECK(vkCreateFence(driver, &fenceInfo, nullptr, &immFence));
 	mainDeletionQueue.push_function([=]() {
 		vkDestroyFence(driver, immFence, nullptr);
@@ -420,6 +778,39 @@ void VulkanEngine::drawBackground(VkCommandBuffer cmd) {
 }
 
 
+void VulkanEngine::drawUpscale(VkCommandBuffer cmd, VkImageView target) {
+	// the upscaled image is a transient that may be recreated, so the set is written every frame
+	VkDescriptorSet set = get_current_frame().descriptorAllocator.allocate(driver, upscaleDescriptorLayout);
+	DescriptorWriter writer(&get_current_frame().arena);
+	writer.writeImage(0, drawImage.imageView, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+	writer.writeImage(1, target, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+	writer.updateSet(driver, set);
+
+	UpscalePushConstants pushConstants{ drawExtent, swapchainExtent, sharpness };
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, upscalePipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, upscalePipelineLayout, 0, 1, &set, 0, nullptr);
+	vkCmdPushConstants(cmd, upscalePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(UpscalePushConstants), &pushConstants);
+	vkCmdDispatch(cmd, std::ceil(swapchainExtent.width / 16.0), std::ceil(swapchainExtent.height / 16.0), 1);
+}
+
+
+void VulkanEngine::writeDrawImageDescriptors() {
+	// frames in flight may still be bound to the previous set, so a new one is allocated rather than updated. Each set
+	// has its own pool, retired once the last submitted frame is done with it
+	if (drawImageDescriptorPool.pool != VK_NULL_HANDLE) {
+		deferredDeletion.destroyDescriptorPool(drawImageDescriptorPool.pool, (uint64_t)frameNumber);
+	}
+	std::vector<DescriptorAllocator::PoolSizeRatio> sizes = { { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 } };
+	drawImageDescriptorPool.initPool(driver, 1, sizes);
+	drawImageDescriptors = drawImageDescriptorPool.allocate(driver, drawImageDescriptorLayout);
+
+	DescriptorWriter writer;
+	writer.writeImage(0, drawImage.imageView, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+	writer.updateSet(driver, drawImageDescriptors);
+}
+
+
 void VulkanEngine::initDescriptors() {
 	std::vector<DynamicDescriptorAllocator::PoolSizeRatio> sizes = {
 		{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
@@ -438,7 +829,7 @@ void VulkanEngine::initDescriptors() {
 	{
 		DescriptorLayoutBuilder builder;
 		builder.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-		gpuSceneDescriptorSetLayout = builder.build(driver, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+		gpuSceneDescriptorSetLayout = builder.build(driver, geometryStages | VK_SHADER_STAGE_FRAGMENT_BIT);
 	}
 
 	{
@@ -447,22 +838,25 @@ void VulkanEngine::initDescriptors() {
 		singleImageDescriptorLayout = builder.build(driver, VK_SHADER_STAGE_FRAGMENT_BIT);
 	}
 
-	drawImageDescriptors = globalDescriptorAllocator.allocate(driver, drawImageDescriptorLayout);
-
 	{
-		DescriptorWriter writer;
-		writer.writeImage(0, drawImage.imageView, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-		writer.updateSet(driver, drawImageDescriptors);
+		DescriptorLayoutBuilder builder;
+		builder.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+		builder.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+		upscaleDescriptorLayout = builder.build(driver, VK_SHADER_STAGE_COMPUTE_BIT);
 	}
 
+	writeDrawImageDescriptors();
+
 	mainDeletionQueue.push_function([&]() {
 		globalDescriptorAllocator.destroyPools(driver);
+		drawImageDescriptorPool.destroyPool(driver);
 		vkDestroyDescriptorSetLayout(driver, drawImageDescriptorLayout, nullptr);
 		vkDestroyDescriptorSetLayout(driver, gpuSceneDescriptorSetLayout, nullptr);
 		vkDestroyDescriptorSetLayout(driver, singleImageDescriptorLayout, nullptr);
+		vkDestroyDescriptorSetLayout(driver, upscaleDescriptorLayout, nullptr);
 		});
 
-	for (int i = 0; i < FRAME_OVERLAP; i++) {
+	for (uint32_t i = 0; i < framesInFlight; i++) {
 		// create a descriptor pool
 		std::vector<DynamicDescriptorAllocator::PoolSizeRatio> frame_sizes = {
 			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3 },
@@ -482,6 +876,8 @@ void VulkanEngine::initDescriptors() {
 
 void VulkanEngine::initPipelines() {
 	initMeshPipeline();
+	initMeshletCullPipeline();
+	initUpscalePipeline();
 	initGradientPipelines();
 	metalRoughMat.buildPipelines(this);
 }
@@ -552,6 +948,74 @@ void VulkanEngine::initMeshPipeline() {
 		});
 }
 
+void VulkanEngine::initMeshletCullPipeline() {
+	VkPushConstantRange pushConstants{};
+	pushConstants.offset = 0;
+	pushConstants.size = sizeof(MeshletCullPushConstants);
+	pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkPipelineLayoutCreateInfo layoutInfo = vkinit::pipeline_layout_create_info();
+	layoutInfo.pPushConstantRanges = &pushConstants;
+	layoutInfo.pushConstantRangeCount = 1;
+
+	VK_CHECK(vkCreatePipelineLayout(driver, &layoutInfo, nullptr, &meshletCullPipelineLayout));
+
+	VkShaderModule cullShader;
+	if (!vkutil::load_shader_module("meshlet_cull.comp", driver, &cullShader)) {
+		fmt::print("[SHADER COMPILE ERROR] error when compiling the compute shader {}\n", "meshlet_cull.comp");
+	}
+
+	VkComputePipelineCreateInfo computePipelineInfo{};
+	computePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineInfo.pNext = nullptr;
+	computePipelineInfo.layout = meshletCullPipelineLayout;
+	computePipelineInfo.stage = vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, cullShader);
+
+	VK_CHECK(vkCreateComputePipelines(driver, VK_NULL_HANDLE, 1, &computePipelineInfo, nullptr, &meshletCullPipeline));
+
+	vkDestroyShaderModule(driver, cullShader, nullptr);
+
+	mainDeletionQueue.push_function([&]() {
+		vkDestroyPipeline(driver, meshletCullPipeline, nullptr);
+		vkDestroyPipelineLayout(driver, meshletCullPipelineLayout, nullptr);
+		});
+}
+
+void VulkanEngine::initUpscalePipeline() {
+	VkPushConstantRange pushConstants{};
+	pushConstants.offset = 0;
+	pushConstants.size = sizeof(UpscalePushConstants);
+	pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkPipelineLayoutCreateInfo layoutInfo = vkinit::pipeline_layout_create_info();
+	layoutInfo.pSetLayouts = &upscaleDescriptorLayout;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstants;
+	layoutInfo.pushConstantRangeCount = 1;
+
+	VK_CHECK(vkCreatePipelineLayout(driver, &layoutInfo, nullptr, &upscalePipelineLayout));
+
+	VkShaderModule upscaleShader;
+	if (!vkutil::load_shader_module("sharpen_upscale.comp", driver, &upscaleShader)) {
+		fmt::print("[SHADER COMPILE ERROR] error when compiling the compute shader {}\n", "sharpen_upscale.comp");
+	}
+
+	VkComputePipelineCreateInfo computePipelineInfo{};
+	computePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineInfo.pNext = nullptr;
+	computePipelineInfo.layout = upscalePipelineLayout;
+	computePipelineInfo.stage = vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, upscaleShader);
+
+	VK_CHECK(vkCreateComputePipelines(driver, VK_NULL_HANDLE, 1, &computePipelineInfo, nullptr, &upscalePipeline));
+
+	vkDestroyShaderModule(driver, upscaleShader, nullptr);
+
+	mainDeletionQueue.push_function([&]() {
+		vkDestroyPipeline(driver, upscalePipeline, nullptr);
+		vkDestroyPipelineLayout(driver, upscalePipelineLayout, nullptr);
+		});
+}
+
 void VulkanEngine::initGradientPipelines() {
 	VkPipelineLayoutCreateInfo computeLayout{};
 	computeLayout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -693,81 +1157,194 @@ void VulkanEngine::drawImGui(VkCommandBuffer cmd, VkImageView targetImageview){
 	vkCmdEndRendering(cmd);
 }
 
-bool isVisible(const RenderObject& obj, const glm::mat4& viewproj) {
-	std::array<glm::vec3, 8> corners{
-		glm::vec3 { 1, 1, 1 },
-		glm::vec3 { 1, 1, -1 },
-		glm::vec3 { 1, -1, 1 },
-		glm::vec3 { 1, -1, -1 },
-		glm::vec3 { -1, 1, 1 },
-		glm::vec3 { -1, 1, -1 },
-		glm::vec3 { -1, -1, 1 },
-		glm::vec3 { -1, -1, -1 },
-	};
-
-	glm::mat4 matrix = viewproj * obj.transform;
+// screen coverage (bounding sphere radius over half the view height) below which each coarser LOD is used
+constexpr std::array<float, MAX_MESH_LODS - 1> LOD_SCREEN_COVERAGE = { 0.25f, 0.12f, 0.05f };
 
-	glm::vec3 min = { 1.5, 1.5, 1.5 };
-	glm::vec3 max = { -1.5, -1.5, -1.5 };
+const MeshLod& selectLod(const RenderObject& obj, const glm::mat4& view, float projectionScale, float bias) {
+	glm::vec3 center = glm::vec3(view * obj.transform * glm::vec4(obj.bounds.origin, 1.f));
+	float scale = std::max({ glm::length(glm::vec3(obj.transform[0])), glm::length(glm::vec3(obj.transform[1])), glm::length(glm::vec3(obj.transform[2])) });
+	float radius = obj.bounds.sphereRadius * scale;
+	float distance = std::max(glm::length(center) - radius, 0.f);
 
-	for (int c = 0; c < 8; c++) {
-		// project each corner into clip space
-		glm::vec4 v = matrix * glm::vec4(obj.bounds.origin + (corners[c] * obj.bounds.extents), 1.f);
-
-		// perspective correction
-		v.x = v.x / v.w;
-		v.y = v.y / v.w;
-		v.z = v.z / v.w;
+	// camera inside the bounding sphere
+	if (distance <= 0.f) {
+		return obj.lods[0];
+	}
 
-		min = glm::min(glm::vec3{ v.x, v.y, v.z }, min);
-		max = glm::max(glm::vec3{ v.x, v.y, v.z }, max);
+	float coverage = radius * projectionScale * bias / distance;
+	uint32_t level = 0;
+	while (level + 1 < obj.lodCount && coverage < LOD_SCREEN_COVERAGE[level]) {
+		level++;
 	}
+	return obj.lods[level];
+}
 
-	// check the clip space box is within the view
-	if (min.z > 1.f || max.z < 0.f || min.x > 1.f || max.x < -1.f || min.y > 1.f || max.y < -1.f) {
-		return false;
+void VulkanEngine::reserveFrameBuffer(AllocatedBuffer& buffer, uint32_t& capacity, uint32_t count, size_t stride, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, uint32_t minCapacity) {
+	if (count <= capacity) {
+		return;
 	}
-	else {
-		return true;
+	// the last submission reading a frame buffer is the one this frame already waited on, so it can be replaced right away
+	if (capacity > 0) {
+		destroyBuffer(buffer);
 	}
+	capacity = std::max(count * 2, minCapacity);
+	buffer = createBuffer(capacity * stride, usage, memoryUsage);
 }
 
-void VulkanEngine::drawMesh(VkCommandBuffer cmd) {
-	VkRenderingAttachmentInfo colorAttachment = vkinit::attachment_info(drawImage.imageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-	VkRenderingAttachmentInfo depthAttachment = vkinit::depth_attachment_info(depthImage.imageView, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+void VulkanEngine::cullMeshlets(VkCommandBuffer cmd, std::span<const GPUMeshletCullJob> jobs, uint32_t commandCount) {
+	FrameData& frame = get_current_frame();
+
+	reserveFrameBuffer(frame.meshletJobBuffer, frame.meshletJobCapacity, (uint32_t)jobs.size(), sizeof(GPUMeshletCullJob),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 64);
+	reserveFrameBuffer(frame.meshletCommandBuffer, frame.meshletCommandCapacity, commandCount, sizeof(VkDrawIndexedIndirectCommand),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY, 1024);
+
+	memcpy(frame.meshletJobBuffer.allocInfo.pMappedData, jobs.data(), jobs.size_bytes());
+
+	MeshletCullPushConstants pushConstants;
+	std::copy(std::begin(sceneData.frustumPlanes), std::end(sceneData.frustumPlanes), pushConstants.frustumPlanes);
+	pushConstants.cameraPosition = glm::vec3(sceneData.cameraPosition);
+	pushConstants.jobCount = (uint32_t)jobs.size();
+	pushConstants.jobBuffer = getBufferAddress(frame.meshletJobBuffer.buffer);
+	pushConstants.commandBuffer = getBufferAddress(frame.meshletCommandBuffer.buffer);
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, meshletCullPipeline);
+	vkCmdPushConstants(cmd, meshletCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MeshletCullPushConstants), &pushConstants);
+	vkCmdDispatch(cmd, (uint32_t)jobs.size(), 1, 1);
+
+	VkBufferMemoryBarrier2 barrier{ .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = frame.meshletCommandBuffer.buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	VkDependencyInfo depInfo{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+	depInfo.bufferMemoryBarrierCount = 1;
+	depInfo.pBufferMemoryBarriers = &barrier;
+
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+}
 
-	VkRenderingInfo renderInfo = vkinit::rendering_info(windowExtent, &colorAttachment, &depthAttachment);
+// consecutive objects sharing the same geometry range and material, drawn with one instanced call
+struct DrawBatch {
+	const RenderObject* object;
+	const MeshLod* lod;
+	bool meshlets;
+	uint32_t meshletCommand;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
 
-	vkCmdBeginRendering(cmd, &renderInfo);
+void VulkanEngine::drawMesh(VkCommandBuffer cmd) {
+	CORE_PROFILE_FUNCTION();
 	auto start = std::chrono::system_clock::now();
-	std::vector<uint32_t> opaque_draws;
-	opaque_draws.reserve(drawContext.OpaqueSurfaces.size());
+	const std::vector<RenderObject>& opaqueObjects = renderList.opaque();
+	const culling::BoundsSoA& opaqueBounds = renderList.opaqueBounds();
+	const BVH& opaqueBvh = renderList.opaqueBvh();
 
-	for (int i = 0; i < drawContext.OpaqueSurfaces.size(); i++) {
-		if (isVisible(drawContext.OpaqueSurfaces[i], sceneData.viewproj)) {
-			opaque_draws.push_back(i);
-		}
+	Core::FrameArena& arena = get_current_frame().arena;
+	std::vector<uint32_t>& opaque_draws = visibleOpaque;
+	opaque_draws.clear();
+
+	const float projectionScale = std::abs(sceneData.projection[1][1]);
+	Core::ArenaVector<const MeshLod*> opaqueLods(opaqueObjects.size(), &arena);
+
+	opaqueBvh.cull(sceneData.frustumPlanes, opaque_draws);
+
+	for (uint32_t i : opaque_draws) {
+		opaqueLods[i] = &selectLod(opaqueObjects[i], sceneData.view, projectionScale, lodBias);
 	}
 
-	// sort the opaque surfaces by material and mesh
-	std::sort(opaque_draws.begin(), opaque_draws.end(), [&](const auto& iA, const auto& iB) {
-		const RenderObject& A = drawContext.OpaqueSurfaces[iA];
-		const RenderObject& B = drawContext.OpaqueSurfaces[iB];
-		if (A.material == B.material) {
-			return A.indexBuffer < B.indexBuffer;
+	// sort the opaque surfaces by pipeline, material and mesh, then front to back
+	drawSortItems.clear();
+	for (uint32_t i : opaque_draws) {
+		const RenderObject& r = opaqueObjects[i];
+		glm::vec3 center{ opaqueBounds.centerX[i], opaqueBounds.centerY[i], opaqueBounds.centerZ[i] };
+		float depth = -(sceneData.view * glm::vec4(center, 1.f)).z;
+		uint32_t geometry = (r.geometryId << 2) | uint32_t(opaqueLods[i] - r.lods);
+		const MaterialInstance& material = assets.materials.get(r.material);
+		drawSortItems.push_back({ drawsort::make_key(0, material.pipeline->sortId, material.sortId, r.indexType == VK_INDEX_TYPE_UINT32, geometry, depth), i });
+	}
+	drawsort::radix_sort(drawSortItems, drawSortScratch);
+	for (size_t i = 0; i < drawSortItems.size(); i++) {
+		opaque_draws[i] = drawSortItems[i].index;
+	}
+
+	// full detail surfaces with meshlets are culled per cluster, by the task shader when there is one or else by a
+	// compute pass writing one indirect draw per meshlet. Both have to be known before rendering starts.
+	Core::ArenaVector<GPUMeshletCullJob> meshletJobs(&arena);
+	uint32_t meshletCommandCount = 0;
+
+	// at most one batch and one instance per drawn object, reserved so the arena sees a single allocation each
+	const size_t drawCount = opaque_draws.size() + renderList.transparent().size();
+	Core::ArenaVector<DrawBatch> batches(&arena);
+	batches.reserve(drawCount);
+	Core::ArenaVector<glm::mat4> instanceTransforms(&arena);
+	instanceTransforms.reserve(drawCount);
+
+	auto addDraw = [&](const RenderObject& r, const MeshLod& lod, bool allowMeshlets) {
+		const bool meshlets = allowMeshlets && &lod == &r.lods[0] && r.meshletCount > 0;
+		uint32_t meshletCommand = UINT32_MAX;
+		if (meshlets && assets.materials.get(r.material).pipeline->meshletPipeline == VK_NULL_HANDLE) {
+			meshletCommand = meshletCommandCount;
+			meshletJobs.push_back(GPUMeshletCullJob{ r.transform, r.meshletBufferAddress, r.meshletCount, meshletCommandCount, r.baseIndex, r.vertexOffset });
+			meshletCommandCount += r.meshletCount;
 		}
-		else {
-			return A.material < B.material;
+
+		// clusters are culled per object, so only plain indexed draws are merged into instances
+		if (!meshlets && !batches.empty()) {
+			DrawBatch& last = batches.back();
+			if (!last.meshlets && last.object->baseIndex + last.lod->startIndex == r.baseIndex + lod.startIndex && last.lod->count == lod.count
+				&& last.object->indexBuffer == r.indexBuffer && last.object->vertexOffset == r.vertexOffset
+				&& last.object->vertexBufferAddress == r.vertexBufferAddress && last.object->material == r.material) {
+				last.instanceCount++;
+				instanceTransforms.push_back(r.transform);
+				return;
+			}
 		}
-		});
+		batches.push_back(DrawBatch{ &r, &lod, meshlets, meshletCommand, (uint32_t)instanceTransforms.size(), 1 });
+		instanceTransforms.push_back(r.transform);
+	};
+
+	for (uint32_t i : opaque_draws) {
+		addDraw(opaqueObjects[i], *opaqueLods[i], true);
+	}
+	// transparent surfaces keep their submission order, only directly repeated ones are merged
+	for (const RenderObject& r : renderList.transparent()) {
+		addDraw(r, selectLod(r, sceneData.view, projectionScale, lodBias), false);
+	}
+
+	if (!meshletJobs.empty()) {
+		cullMeshlets(cmd, meshletJobs, meshletCommandCount);
+	}
+
+	FrameData& frame = get_current_frame();
+	VkDeviceAddress instanceBufferAddress = 0;
+	if (!instanceTransforms.empty()) {
+		reserveFrameBuffer(frame.instanceBuffer, frame.instanceCapacity, (uint32_t)instanceTransforms.size(), sizeof(glm::mat4),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 1024);
+		memcpy(frame.instanceBuffer.allocInfo.pMappedData, instanceTransforms.data(), instanceTransforms.size() * sizeof(glm::mat4));
+		instanceBufferAddress = getBufferAddress(frame.instanceBuffer.buffer);
+	}
+
+	VkRenderingAttachmentInfo colorAttachment = vkinit::attachment_info(drawImage.imageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	VkRenderingAttachmentInfo depthAttachment = vkinit::depth_attachment_info(depthImage.imageView, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
+	// only the scaled part of the targets is cleared, loaded and stored, the targets always contain it
+	VkRenderingInfo renderInfo = vkinit::rendering_info(drawExtent, &colorAttachment, &depthAttachment);
+
+	vkCmdBeginRendering(cmd, &renderInfo);
 
 	//allocate a new uniform buffer for the scene data
 	AllocatedBuffer gpuSceneDataBuffer = createBuffer(sizeof(GPUSceneData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
 
-	//add it to the deletion queue of this frame so it gets deleted once its been used
-	get_current_frame().deletionQueue.push_function([=, this]() {
-		destroyBuffer(gpuSceneDataBuffer);
-		});
+	//deleted once the timeline passes the value this frame signals
+	deferredDeletion.destroyBuffer(gpuSceneDataBuffer, (uint64_t)frameNumber + 1);
 
 	//write the buffer
 	GPUSceneData* sceneUniformData = (GPUSceneData*)gpuSceneDataBuffer.allocation->GetMappedData();
@@ -776,77 +1353,91 @@ void VulkanEngine::drawMesh(VkCommandBuffer cmd) {
 	//create a descriptor set that binds that buffer and update it
 	VkDescriptorSet globalDescriptor = get_current_frame().descriptorAllocator.allocate(driver, gpuSceneDescriptorSetLayout);
 
-	DescriptorWriter writer;
+	DescriptorWriter writer(&arena);
 	writer.writeBuffer(0, gpuSceneDataBuffer.buffer, sizeof(GPUSceneData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 	writer.updateSet(driver, globalDescriptor);
 
-	MaterialPipeline* lastPipeline = nullptr;
-	MaterialInstance* lastMaterial = nullptr;
+	VkPipeline lastPipeline = VK_NULL_HANDLE;
+	MaterialHandle lastMaterial;
 	VkBuffer lastIndexBuffer = VK_NULL_HANDLE;
-
-	auto draw = [&](const RenderObject& r) {
+	VkIndexType lastIndexType = VK_INDEX_TYPE_MAX_ENUM;
+
+	auto draw = [&](const DrawBatch& batch) {
+		const RenderObject& r = *batch.object;
+		const MeshLod& lod = *batch.lod;
+		const MaterialInstance& material = assets.materials.get(r.material);
+		const bool meshletTasks = batch.meshlets && material.pipeline->meshletPipeline != VK_NULL_HANDLE;
+		VkPipeline pipeline = meshletTasks ? material.pipeline->meshletPipeline : material.pipeline->pipeline;
+
+		if (pipeline != lastPipeline) {
+			lastPipeline = pipeline;
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material.pipeline->layout, 0, 1,
+				&globalDescriptor, 0, nullptr);
+
+			VkViewport viewport = {};
+			viewport.x = 0;
+			viewport.y = 0;
+			viewport.width = drawExtent.width;
+			viewport.height = drawExtent.height;
+			viewport.minDepth = 0.f;
+			viewport.maxDepth = 1.f;
+
+			vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+			VkRect2D scissor = {};
+			scissor.offset.x = 0;
+			scissor.offset.y = 0;
+			scissor.extent.width = drawExtent.width;
+			scissor.extent.height = drawExtent.height;
+
+			vkCmdSetScissor(cmd, 0, 1, &scissor);
+		}
 		if (r.material != lastMaterial) {
 			lastMaterial = r.material;
-			if (r.material->pipeline != lastPipeline) {
-
-				lastPipeline = r.material->pipeline;
-				vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r.material->pipeline->pipeline);
-				vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r.material->pipeline->layout, 0, 1,
-					&globalDescriptor, 0, nullptr);
-
-				VkViewport viewport = {};
-				viewport.x = 0;
-				viewport.y = 0;
-				viewport.width = drawExtent.width;
-				viewport.height = drawExtent.height;
-				viewport.minDepth = 0.f;
-				viewport.maxDepth = 1.f;
-
-				vkCmdSetViewport(cmd, 0, 1, &viewport);
-
-				VkRect2D scissor = {};
-				scissor.offset.x = 0;
-				scissor.offset.y = 0;
-				scissor.extent.width = drawExtent.width;
-				scissor.extent.height = drawExtent.height;
-
-				vkCmdSetScissor(cmd, 0, 1, &scissor);
-			}
-
-			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, r.material->pipeline->layout, 1, 1,
-				&r.material->materialSet, 0, nullptr);
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material.pipeline->layout, 1, 1,
+				&material.materialSet, 0, nullptr);
 		}
-		if (r.indexBuffer != lastIndexBuffer) {
+		if (!meshletTasks && (r.indexBuffer != lastIndexBuffer || r.indexType != lastIndexType)) {
 			lastIndexBuffer = r.indexBuffer;
-			vkCmdBindIndexBuffer(cmd, r.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+			lastIndexType = r.indexType;
+			vkCmdBindIndexBuffer(cmd, r.indexBuffer, 0, r.indexType);
 		}
 		// calculate final mesh matrix
 		GPUDrawPushConstants push_constants;
 		push_constants.worldMatrix = r.transform;
-		push_constants.vertexBuffer = r.vertexBufferAddress;
+		// the mesh shader indexes vertices itself, so it gets the address of the first vertex of the mesh
+		push_constants.vertexBuffer = meshletTasks ? r.vertexBufferAddress + r.vertexOffset * sizeof(Vertex) : r.vertexBufferAddress;
+		// rebased onto the first instance so draws never depend on firstInstance
+		push_constants.instanceBuffer = instanceBufferAddress + batch.firstInstance * sizeof(glm::mat4);
+		push_constants.meshletBuffer = r.meshletBufferAddress;
+		push_constants.meshletData = r.meshletDataAddress;
+		push_constants.meshletCount = r.meshletCount;
 
-		vkCmdPushConstants(cmd, r.material->pipeline->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GPUDrawPushConstants), &push_constants);
+		vkCmdPushConstants(cmd, material.pipeline->layout, geometryStages, 0, sizeof(GPUDrawPushConstants), &push_constants);
 
+		// meshlet draws count every submitted triangle, the gpu culled share is not read back
 		stats.drawcall_count++;
-		stats.triangle_count += r.indexCount / 3;
-		vkCmdDrawIndexed(cmd, r.indexCount, 1, r.firstIndex, 0, 0);
+		stats.triangle_count += lod.count / 3 * batch.instanceCount;
+		if (meshletTasks) {
+			cmdDrawMeshTasks(cmd, (r.meshletCount + MESHLET_TASK_GROUP_SIZE - 1) / MESHLET_TASK_GROUP_SIZE, 1, 1);
+		}
+		else if (batch.meshletCommand != UINT32_MAX) {
+			vkCmdDrawIndexedIndirect(cmd, frame.meshletCommandBuffer.buffer, batch.meshletCommand * sizeof(VkDrawIndexedIndirectCommand),
+				r.meshletCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		else {
+			vkCmdDrawIndexed(cmd, lod.count, batch.instanceCount, r.baseIndex + lod.startIndex, r.vertexOffset, 0);
+		}
 		};
 
 	stats.drawcall_count = 0;
 	stats.triangle_count = 0;
 
-	for (auto& r : opaque_draws) {
-		draw(drawContext.OpaqueSurfaces[r]);
-	}
-
-	for (auto& r : drawContext.TransparentSurfaces) {
-		draw(r);
+	for (const DrawBatch& batch : batches) {
+		draw(batch);
 	}
 
-	// we delete the draw commands now that we processed them
-	drawContext.OpaqueSurfaces.clear();
-	drawContext.TransparentSurfaces.clear();
-
 	auto end = std::chrono::system_clock::now();
 	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
 
@@ -876,48 +1467,130 @@ void VulkanEngine::destroyBuffer(const AllocatedBuffer& buffer) {
 	vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
 }
 
+void VulkanEngine::collectAssets(uint64_t completedValue) {
+	assets.meshes.collect(completedValue, [&](MeshAsset& mesh) { destroyMesh(mesh.meshBuffers); });
+	assets.images.collect(completedValue, [&](AllocatedImage& image) { destroyImage(image); });
+	// material sets belong to the descriptor pools of their file, retired with it
+	assets.materials.collect(completedValue, [](MaterialInstance&) {});
+}
+
+void VulkanEngine::destroyMesh(const GPUMeshBuffers& mesh) {
+	geometryPool.free(mesh.geometry);
+	if (mesh.meshletBuffer.buffer != VK_NULL_HANDLE) {
+		destroyBuffer(mesh.meshletBuffer);
+	}
+}
+
+VkDeviceAddress VulkanEngine::getBufferAddress(VkBuffer buffer) {
+	VkBufferDeviceAddressInfo addrInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
+	addrInfo.buffer = buffer;
+	return vkGetBufferDeviceAddress(driver, &addrInfo);
+}
+
 
 GPUMeshBuffers VulkanEngine::uploadMesh(std::span<uint32_t> indices, std::span<Vertex> vertices) {
+	std::vector<AllocatedBuffer> staging;
+	GPUMeshBuffers mesh;
+	immediate_cmd([&](VkCommandBuffer cmd) {
+		mesh = uploadMesh(cmd, indices, vertices, staging);
+		});
+	for (const AllocatedBuffer& buffer : staging) {
+		destroyBuffer(buffer);
+	}
+	return mesh;
+}
+
+GPUMeshBuffers VulkanEngine::uploadMesh(VkCommandBuffer cmd, std::span<uint32_t> indices, std::span<Vertex> vertices, std::vector<AllocatedBuffer>& staging) {
+	CORE_PROFILE_FUNCTION();
+	// every index of a mesh with at most 65536 vertices fits in 16 bits
+	const bool smallIndices = vertices.size() <= 65536;
+	const size_t indexSize = smallIndices ? sizeof(uint16_t) : sizeof(uint32_t);
 	const size_t vertexBufferSize = vertices.size() * sizeof(Vertex);
-	const size_t indexBufferSize = indices.size() * sizeof(uint32_t);
+	const size_t indexBufferSize = indices.size() * indexSize;
 
-	GPUMeshBuffers newSurface;
+	GPUMeshBuffers newSurface{};
+	newSurface.id = meshCount++;
+	newSurface.indexType = smallIndices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
 
-	newSurface.vertexBuffer = createBuffer(vertexBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	if (!geometryPool.allocate((uint32_t)vertices.size(), indexBufferSize, newSurface.geometry)) {
+		fmt::print("[VULKAN ERROR]: geometry pool allocation of {} vertices failed\n", vertices.size());
+		abort();
+	}
+	const GeometryPool::Page& page = geometryPool.page(newSurface.geometry.page);
+	newSurface.indexBuffer = page.indexBuffer.buffer;
+	newSurface.vertexBufferAddress = page.vertexBufferAddress;
+	newSurface.firstIndex = (uint32_t)(newSurface.geometry.indexOffset / indexSize);
+	newSurface.vertexOffset = (int32_t)newSurface.geometry.firstVertex;
 
-	VkBufferDeviceAddressInfo addrInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
-	addrInfo.buffer = newSurface.vertexBuffer.buffer;
-	newSurface.vertexBufferAddress = vkGetBufferDeviceAddress(driver, &addrInfo);
+	AllocatedBuffer buffer = createBuffer(vertexBufferSize + indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+	staging.push_back(buffer);
 
-	newSurface.indexBuffer = createBuffer(indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	void* data = buffer.allocation->GetMappedData();
 
-	AllocatedBuffer staging = createBuffer(vertexBufferSize + indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+	memcpy(data, vertices.data(), vertexBufferSize);
 
-	void* data = staging.allocation->GetMappedData();
+	if (smallIndices) {
+		uint16_t* dst = (uint16_t*)((char*)data + vertexBufferSize);
+		for (size_t i = 0; i < indices.size(); i++) {
+			dst[i] = static_cast<uint16_t>(indices[i]);
+		}
+	}
+	else {
+		memcpy((char*)data + vertexBufferSize, indices.data(), indexBufferSize);
+	}
 
-	memcpy(data, vertices.data(), vertexBufferSize);
+	VkBufferCopy vertexCopy{ 0 };
+	vertexCopy.dstOffset = newSurface.geometry.firstVertex * sizeof(Vertex);
+	vertexCopy.srcOffset = 0;
+	vertexCopy.size = vertexBufferSize;
 
-	memcpy((char*)data + vertexBufferSize, indices.data(), indexBufferSize);
+	vkCmdCopyBuffer(cmd, buffer.buffer, page.vertexBuffer.buffer, 1, &vertexCopy);
 
-	immediate_cmd([&](VkCommandBuffer cmd) {
-		VkBufferCopy vertexCopy{ 0 };
-		vertexCopy.dstOffset = 0;
-		vertexCopy.srcOffset = 0;
-		vertexCopy.size = vertexBufferSize;
+	VkBufferCopy indexCopy;
+	indexCopy.dstOffset = newSurface.geometry.indexOffset;
+	indexCopy.srcOffset = vertexBufferSize;
+	indexCopy.size = indexBufferSize;
 
-		vkCmdCopyBuffer(cmd, staging.buffer, newSurface.vertexBuffer.buffer, 1, &vertexCopy);
+	vkCmdCopyBuffer(cmd, buffer.buffer, page.indexBuffer.buffer, 1, &indexCopy);
 
-		VkBufferCopy indexCopy;
-		indexCopy.dstOffset = 0;
-		indexCopy.srcOffset = vertexBufferSize;
-		indexCopy.size = indexBufferSize;
+	return newSurface;
+}
 
-		vkCmdCopyBuffer(cmd, staging.buffer, newSurface.indexBuffer.buffer, 1, &indexCopy);
+void VulkanEngine::uploadMeshlets(GPUMeshBuffers& mesh, MeshletData& meshlets) {
+	std::vector<AllocatedBuffer> staging;
+	immediate_cmd([&](VkCommandBuffer cmd) {
+		uploadMeshlets(cmd, mesh, meshlets, staging);
 		});
+	for (const AllocatedBuffer& buffer : staging) {
+		destroyBuffer(buffer);
+	}
+}
 
-	destroyBuffer(staging);
+void VulkanEngine::uploadMeshlets(VkCommandBuffer cmd, GPUMeshBuffers& mesh, MeshletData& meshlets, std::vector<AllocatedBuffer>& staging) {
+	meshlet::fixup_offsets(meshlets);
 
-	return newSurface;
+	const size_t meshletSize = meshlets.meshlets.size() * sizeof(GPUMeshlet);
+	const size_t vertexSize = meshlets.vertices.size() * sizeof(uint32_t);
+	const size_t triangleSize = meshlets.triangles.size();
+	const size_t bufferSize = meshletSize + vertexSize + triangleSize;
+
+	mesh.meshletBuffer = createBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	mesh.meshletBufferAddress = getBufferAddress(mesh.meshletBuffer.buffer);
+
+	AllocatedBuffer buffer = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+	staging.push_back(buffer);
+
+	char* data = (char*)buffer.allocation->GetMappedData();
+	memcpy(data, meshlets.meshlets.data(), meshletSize);
+	memcpy(data + meshletSize, meshlets.vertices.data(), vertexSize);
+	memcpy(data + meshletSize + vertexSize, meshlets.triangles.data(), triangleSize);
+
+	VkBufferCopy copy{ 0 };
+	copy.dstOffset = 0;
+	copy.srcOffset = 0;
+	copy.size = bufferSize;
+
+	vkCmdCopyBuffer(cmd, buffer.buffer, mesh.meshletBuffer.buffer, 1, &copy);
 }
 
 void VulkanEngine::init_default_data() {
@@ -925,11 +1598,10 @@ void VulkanEngine::init_default_data() {
 	sceneMeshes = load_gltf_meshes(this, "basicmesh.glb").value();
 
 	mainDeletionQueue.push_function([&]() {
-		for (std::shared_ptr<MeshAsset> mesh : sceneMeshes) {
-			destroyBuffer(mesh->meshBuffers.indexBuffer);
-			destroyBuffer(mesh->meshBuffers.vertexBuffer);
-			mesh->meshBuffers = {};
+		for (MeshHandle mesh : sceneMeshes) {
+			assets.meshes.release(mesh, (uint64_t)frameNumber);
 		}
+		assets.materials.release(defaultMat, (uint64_t)frameNumber);
 		});
 
 	uint32_t white = glm::packUnorm4x8(glm::vec4(1.f));
@@ -985,32 +1657,65 @@ void VulkanEngine::init_default_data() {
 		});
 	materialRes.dataBuffer = materialConst.buffer;
 	materialRes.bufferOffset = 0;
-	defaultMat = metalRoughMat.writeMaterial(driver, MaterialPass::MAIN_COLOR, materialRes, globalDescriptorAllocator);
+	defaultMat = assets.materials.add(metalRoughMat.writeMaterial(driver, MaterialPass::MAIN_COLOR, materialRes, globalDescriptorAllocator));
 
-	for (auto& m : sceneMeshes) {
+	for (MeshHandle m : sceneMeshes) {
 		std::shared_ptr<MeshNode> newNode = std::make_shared<MeshNode>();
 		newNode->mesh = m;
 		newNode->localTransform = glm::mat4{ 1.f };
 		newNode->worldTransform = glm::mat4{ 1.f };
 
-		for (auto& s : newNode->mesh->surfaces) {
-			s.material = std::make_shared<GLTFMaterial>(defaultMat);
+		MeshAsset& mesh = assets.meshes.get(m);
+		for (auto& s : mesh.surfaces) {
+			s.material = defaultMat;
 		}
-		loadedNodes[m->name] = std::move(newNode);
+		loadedNodes[mesh.name] = std::move(newNode);
 	}
 }
 
 void VulkanEngine::resizeSwapchain() {
-	vkDeviceWaitIdle(driver);
-	destroySwapchain();
-
 	int width, height;
 	SDL_GetWindowSize(window, &width, &height);
+	// minimized, retried once the window has a size again
+	if (width == 0 || height == 0) {
+		return;
+	}
 	windowExtent.width = width;
 	windowExtent.height = height;
 
+	// frames in flight may still use the old swapchain, and the frame timeline says nothing about when the presentation
+	// engine is done waiting on its present semaphores. Without present fences, the old swapchain is kept until the
+	// new one has presented each of its images once, see draw
+	RetiredSwapchain retired;
+	retired.swapchain = swapchain;
+	retired.views = std::move(swapchainImageViews);
+	retired.presentSemaphores = std::move(presentSemaphores);
+	for (VkImage image : swapchainImages) {
+		barriers.forget(image);
+	}
 	createSwapchain(width, height);
+	retired.presentsLeft = (uint32_t)swapchainImages.size();
+	retiredSwapchains.push_back(std::move(retired));
+
+	// render targets only grow, rounded up so a window dragged larger does not reallocate every frame.
+	// drawExtent covers the part in use
+	if (swapchainExtent.width > drawImage.imageExtent.width || swapchainExtent.height > drawImage.imageExtent.height) {
+		auto roundUp = [](uint32_t size) { return (size + RENDER_TARGET_GRANULARITY - 1) / RENDER_TARGET_GRANULARITY * RENDER_TARGET_GRANULARITY; };
+		AllocatedImage oldDraw = drawImage;
+		AllocatedImage oldDepth = depthImage;
+		barriers.forget(oldDraw.image);
+		barriers.forget(oldDepth.image);
+		createRenderTargets(VkExtent2D{
+			roundUp(std::max(swapchainExtent.width, drawImage.imageExtent.width)),
+			roundUp(std::max(swapchainExtent.height, drawImage.imageExtent.height)) });
+		writeDrawImageDescriptors();
+		// frameNumber is the value the last submitted frame signals
+		deferredDeletion.destroyImage(oldDraw, (uint64_t)frameNumber);
+		deferredDeletion.destroyImage(oldDepth, (uint64_t)frameNumber);
+		fmt::print("[CONSOLE INFO]: render targets grown to {}x{}\n", drawImage.imageExtent.width, drawImage.imageExtent.height);
+	}
 
+	fmt::print("[CONSOLE INFO]: Resized to {}, {}\n", windowExtent.width, windowExtent.height);
 	resizeRequest = false;
 }
 
@@ -1044,34 +1749,44 @@ AllocatedImage VulkanEngine::createImage(VkExtent3D size, VkFormat format, VkIma
 }
 
 AllocatedImage VulkanEngine::createImage(void* data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped) {
+	std::vector<AllocatedBuffer> staging;
+	AllocatedImage newImage;
+	immediate_cmd([&](VkCommandBuffer cmd) {
+		newImage = createImage(cmd, data, size, format, usage, mipmapped, staging);
+		});
+	for (const AllocatedBuffer& buffer : staging) {
+		destroyBuffer(buffer);
+	}
+	return newImage;
+}
+
+AllocatedImage VulkanEngine::createImage(VkCommandBuffer cmd, void* data, VkExtent3D size, VkFormat format, VkImageUsageFlags usage, bool mipmapped, std::vector<AllocatedBuffer>& staging) {
 	size_t data_size = size.depth * size.width * size.height * 4;
 	AllocatedBuffer uploadBuffer = createBuffer(data_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	staging.push_back(uploadBuffer);
 	memcpy(uploadBuffer.allocInfo.pMappedData, data, data_size);
 	AllocatedImage newImage = createImage(size, format, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, mipmapped);
-	immediate_cmd([=](VkCommandBuffer cmd) {
-		vkutil::transition_image(cmd, newImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-		VkBufferImageCopy copyRegion = {};
-		copyRegion.bufferOffset = 0;
-		copyRegion.bufferRowLength = 0;
-		copyRegion.bufferImageHeight = 0;
-
-		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		copyRegion.imageSubresource.mipLevel = 0;
-		copyRegion.imageSubresource.baseArrayLayer = 0;
-		copyRegion.imageSubresource.layerCount = 1;
-		copyRegion.imageExtent = size;
-
-		vkCmdCopyBufferToImage(cmd, uploadBuffer.buffer, newImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
-		if (mipmapped) {
-			vkutil::generate_mipmaps(cmd, newImage.image, VkExtent2D{ newImage.imageExtent.width,newImage.imageExtent.height });
-		}
-		else {
-			vkutil::transition_image(cmd, newImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-		}
-		});
 
-	destroyBuffer(uploadBuffer);
+	vkutil::transition_image(cmd, newImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	VkBufferImageCopy copyRegion = {};
+	copyRegion.bufferOffset = 0;
+	copyRegion.bufferRowLength = 0;
+	copyRegion.bufferImageHeight = 0;
+
+	copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copyRegion.imageSubresource.mipLevel = 0;
+	copyRegion.imageSubresource.baseArrayLayer = 0;
+	copyRegion.imageSubresource.layerCount = 1;
+	copyRegion.imageExtent = size;
+
+	vkCmdCopyBufferToImage(cmd, uploadBuffer.buffer, newImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+	if (mipmapped) {
+		vkutil::generate_mipmaps(cmd, newImage.image, VkExtent2D{ newImage.imageExtent.width,newImage.imageExtent.height });
+	}
+	else {
+		vkutil::transition_image(cmd, newImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
 	return newImage;
 }
 
@@ -1081,21 +1796,120 @@ void VulkanEngine::destroyImage(const AllocatedImage& image) {
 }
 
 void VulkanEngine::updateScene() {
+	CORE_PROFILE_FUNCTION();
 	camera.update();
-	drawContext.OpaqueSurfaces.clear();
-	loadedNodes["Suzanne"]->Draw(glm::mat4{ 1.f }, drawContext); 
-	loadedScenes["structure"]->Draw(glm::mat4{ 1.f }, drawContext);
+	// only nodes moved since the last frame touch the render list
+	for (auto& [name, scene] : loadedScenes) {
+		scene->graph.updateTransforms(&threadPool);
+	}
 	long long time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
 	sceneData.view = camera.getViewMatrix();
 	sceneData.projection = glm::perspective(glm::radians(70.f), (float)windowExtent.width / (float)windowExtent.height, 10000.f, 0.1f);
 	sceneData.projection[1][1] *= -1;
 	sceneData.viewproj = sceneData.projection * sceneData.view;
+	culling::extract_planes(sceneData.viewproj, sceneData.frustumPlanes);
+	sceneData.cameraPosition = glm::vec4(camera.position, 1.f);
 
 	sceneData.ambientColor = glm::vec4(0.03f, 0.03f, 0.03f, 1.f);
 	sceneData.sunlightColor = glm::vec4(1.f, 1.f, 0.9f, 1.f);
 	sceneData.sunlightDirection = glm::vec4(glm::normalize(glm::vec3(1, -3, -1)), 1.f);
 }
 
+void VulkanEngine::runHeadless() {
+	auto runStart = std::chrono::system_clock::now();
+	uint32_t frameCount = 0;
+	// a benchmark path sets its own frame count
+	while (benchmark.active() ? benchmark.beginFrame(camera) : frameCount < headlessFrames) {
+		CORE_PROFILE_SCOPE("frame");
+		auto start = std::chrono::system_clock::now();
+
+		draw();
+
+		auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - start);
+		stats.frametime = elapsed.count() / 1000.f;
+		recordBenchmarkFrame();
+		frameCount++;
+	}
+
+	// captures of the last frames in flight are written here, their slots are not drawn again
+	vkDeviceWaitIdle(driver);
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		if (frames[i].captureFrame >= 0) {
+			writeCapture(frames[i]);
+		}
+	}
+
+	auto total = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - runStart);
+	fmt::print("[CONSOLE INFO]: {} headless frames at {}x{} in {:.1f} ms, {:.3f} ms per frame\n", frameCount, windowExtent.width, windowExtent.height,
+		total.count() / 1000.f, total.count() / 1000.f / std::max(frameCount, 1u));
+	if (benchmark.active()) {
+		benchmark.writeReport(benchmarkReport);
+	}
+}
+
+void VulkanEngine::collectLatency() {
+	uint64_t completed = 0;
+	VK_CHECK(vkGetSemaphoreCounterValue(driver, frameTimeline, &completed));
+	auto now = std::chrono::system_clock::now();
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		FrameData& frame = frames[i];
+		if (frame.latencyPending && frame.timelineValue <= completed) {
+			stats.input_latency = std::chrono::duration_cast<std::chrono::microseconds>(now - frame.inputTime).count() / 1000.f;
+			frame.latencyPending = false;
+		}
+	}
+}
+
+void VulkanEngine::recordBenchmarkFrame() {
+	if (benchmark.active()) {
+		// the wait for the frame slot is time spent on the GPU's behalf, the rest of the frame is CPU work
+		float gpuMs = gpuProfiler.enabled() ? gpuProfiler.frame().lastMs : NAN;
+		benchmark.endFrame(stats.frametime, stats.frametime - stats.fence_wait_time, gpuMs, stats.triangle_count, stats.drawcall_count);
+	}
+	if (recordingPath) {
+		recordingTime += stats.frametime / 1000.f;
+		recordedPath.add(CameraPath::Keyframe{ recordingTime, camera.position, camera.pitch, camera.yaw });
+	}
+}
+
+void VulkanEngine::writeCapture(FrameData& frame) {
+	const VkExtent2D extent = frame.captureExtent;
+	const size_t pixelCount = (size_t)extent.width * extent.height;
+	vmaInvalidateAllocation(allocator, frame.readbackBuffer.allocation, 0, pixelCount * sizeof(uint16_t) * 4);
+
+	// the draw image is half float, clamped to 8 bits the same way the blit into the unorm swapchain does
+	const uint16_t* source = (const uint16_t*)frame.readbackBuffer.allocInfo.pMappedData;
+	std::vector<uint8_t> pixels(pixelCount * 4);
+	for (size_t i = 0; i < pixels.size(); i++) {
+		float value = glm::unpackHalf1x16(source[i]);
+		pixels[i] = (uint8_t)(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+	}
+	for (size_t i = 3; i < pixels.size(); i += 4) {
+		pixels[i] = 255;
+	}
+
+	std::string path = fmt::format("capture_{}.png", frame.captureFrame);
+	if (stbi_write_png(path.c_str(), extent.width, extent.height, 4, pixels.data(), extent.width * 4)) {
+		fmt::print("[CONSOLE INFO]: frame {} written to {}\n", frame.captureFrame, path);
+	}
+	else {
+		fmt::print("[I/O ERROR]: could not write frame capture to {}\n", path);
+	}
+	frame.captureFrame = -1;
+}
+
+void VulkanEngine::writeTrace() {
+#if CORE_PROFILING
+	std::string path = fmt::format("trace_{}.json", frameNumber);
+	if (Core::Profiler::WriteChromeTrace(path)) {
+		fmt::print("[CONSOLE INFO]: cpu trace written to {}\n", path);
+	}
+	else {
+		fmt::print("[I/O ERROR]: could not write cpu trace to {}\n", path);
+	}
+#endif
+}
+
 void GLTFMetallic_Roughness::buildPipelines(VulkanEngine* engine)
 {
 	VkShaderModule meshFragShader;
@@ -1111,14 +1925,14 @@ void GLTFMetallic_Roughness::buildPipelines(VulkanEngine* engine)
 	VkPushConstantRange matrixRange{};
 	matrixRange.offset = 0;
 	matrixRange.size = sizeof(GPUDrawPushConstants);
-	matrixRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	matrixRange.stageFlags = engine->geometryStages;
 
 	DescriptorLayoutBuilder layoutBuilder;
 	layoutBuilder.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 	layoutBuilder.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 	layoutBuilder.addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 
-	materialLayout = layoutBuilder.build(engine->driver, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+	materialLayout = layoutBuilder.build(engine->driver, engine->geometryStages | VK_SHADER_STAGE_FRAGMENT_BIT);
 
 	VkDescriptorSetLayout layouts[] = { engine->gpuSceneDescriptorSetLayout,
 		materialLayout };
@@ -1134,6 +1948,8 @@ void GLTFMetallic_Roughness::buildPipelines(VulkanEngine* engine)
 
 	opaquePipeline.layout = newLayout;
 	transparentPipeline.layout = newLayout;
+	opaquePipeline.sortId = 0;
+	transparentPipeline.sortId = 1;
 
 	// build the stage-create-info for both vertex and fragment stages. This lets
 	// the pipeline know the shader modules per stage
@@ -1156,6 +1972,28 @@ void GLTFMetallic_Roughness::buildPipelines(VulkanEngine* engine)
 	// finally build the pipeline
 	opaquePipeline.pipeline = pipelineBuilder.buildPipeline(engine->driver);
 
+	// same state with the meshlet task/mesh stages, blended surfaces always take the vertex path
+	opaquePipeline.meshletPipeline = VK_NULL_HANDLE;
+	transparentPipeline.meshletPipeline = VK_NULL_HANDLE;
+	if (engine->meshShaderSupported) {
+		VkShaderModule meshletTaskShader;
+		if (!vkutil::load_shader_module("meshlet.task", engine->driver, &meshletTaskShader)) {
+			fmt::println("Error when building the meshlet task shader module");
+		}
+
+		VkShaderModule meshletMeshShader;
+		if (!vkutil::load_shader_module("meshlet.mesh", engine->driver, &meshletMeshShader)) {
+			fmt::println("Error when building the meshlet mesh shader module");
+		}
+
+		pipelineBuilder.setMeshShaders(meshletTaskShader, meshletMeshShader, meshFragShader);
+		opaquePipeline.meshletPipeline = pipelineBuilder.buildPipeline(engine->driver);
+		pipelineBuilder.setShaders(meshVertexShader, meshFragShader);
+
+		vkDestroyShaderModule(engine->driver, meshletTaskShader, nullptr);
+		vkDestroyShaderModule(engine->driver, meshletMeshShader, nullptr);
+	}
+
 	// create the transparent variant
 	pipelineBuilder.enableBlendingAdditive();
 
@@ -1169,6 +2007,7 @@ void GLTFMetallic_Roughness::buildPipelines(VulkanEngine* engine)
 
 MaterialInstance GLTFMetallic_Roughness::writeMaterial(VkDevice device, MaterialPass pass, const MaterialResources& resources, DynamicDescriptorAllocator& allocator) {
 	MaterialInstance matData;
+	matData.sortId = materialCount++;
 	matData.passType = pass;
 	if (pass == MaterialPass::TRASNPARENT) {
 		matData.pipeline = &transparentPipeline;
@@ -1196,29 +2035,14 @@ void GLTFMetallic_Roughness::clearResources(VkDevice device)
 
 	vkDestroyPipeline(device, transparentPipeline.pipeline, nullptr);
 	vkDestroyPipeline(device, opaquePipeline.pipeline, nullptr);
+	if (opaquePipeline.meshletPipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(device, opaquePipeline.meshletPipeline, nullptr);
+	}
 }
 
 
 void MeshNode::Draw(const glm::mat4& topMatrix, DrawContext& ctx) {
-	glm::mat4 nodeMatrix = topMatrix * worldTransform;
-
-	for (auto& s : mesh->surfaces) {
-		RenderObject obj;
-		obj.indexCount = s.count;
-		obj.firstIndex = s.startIndex;
-		obj.indexBuffer = mesh->meshBuffers.indexBuffer.buffer;
-		obj.material = &s.material->data;
-		obj.bounds = s.bounds;
-		obj.transform = nodeMatrix;
-		obj.vertexBufferAddress = mesh->meshBuffers.vertexBufferAddress;
-
-		if (s.material->data.passType == MaterialPass::TRASNPARENT) {
-			ctx.TransparentSurfaces.push_back(obj);
-		}
-		else {
-			ctx.OpaqueSurfaces.push_back(obj);
-		}
-	}
-
+	const AssetPools& assets = VulkanEngine::get().assets;
+	addMeshDraws(assets.meshes.get(mesh), assets, topMatrix * worldTransform, ctx);
 	Node::Draw(topMatrix, ctx);
 }
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "vk_geometry_pool.h"
+
+void GeometryPool::init(VkDevice device, VmaAllocator allocator, uint32_t vertexPageSize, VkDeviceSize indexPageSize) {
+	this->device = device;
+	this->allocator = allocator;
+	this->vertexPageSize = vertexPageSize;
+	this->indexPageSize = indexPageSize;
+}
+
+void GeometryPool::destroy() {
+	for (Page& p : pages) {
+		// meshes still alive at shutdown are released together with their page
+		vmaClearVirtualBlock(p.vertexBlock);
+		vmaClearVirtualBlock(p.indexBlock);
+		vmaDestroyVirtualBlock(p.vertexBlock);
+		vmaDestroyVirtualBlock(p.indexBlock);
+		vmaDestroyBuffer(allocator, p.vertexBuffer.buffer, p.vertexBuffer.allocation);
+		vmaDestroyBuffer(allocator, p.indexBuffer.buffer, p.indexBuffer.allocation);
+	}
+	pages.clear();
+}
+
+bool GeometryPool::allocate(uint32_t vertexCount, VkDeviceSize indexBytes, GeometryAllocation& out) {
+	for (uint32_t i = 0; i < pages.size(); i++) {
+		if (tryAllocate(i, vertexCount, indexBytes, out)) {
+			return true;
+		}
+	}
+
+	// meshes bigger than a page get a page sized to fit them
+	addPage(std::max(vertexCount, vertexPageSize), std::max(indexBytes, indexPageSize));
+	return tryAllocate((uint32_t)pages.size() - 1, vertexCount, indexBytes, out);
+}
+
+void GeometryPool::free(const GeometryAllocation& allocation) {
+	if (allocation.page == UINT32_MAX) {
+		return;
+	}
+	Page& p = pages[allocation.page];
+	vmaVirtualFree(p.vertexBlock, allocation.vertexAllocation);
+	vmaVirtualFree(p.indexBlock, allocation.indexAllocation);
+}
+
+VkDeviceSize GeometryPool::usedBytes() const {
+	VkDeviceSize used = 0;
+	for (const Page& p : pages) {
+		VmaStatistics stats;
+		vmaGetVirtualBlockStatistics(p.vertexBlock, &stats);
+		used += stats.allocationBytes * sizeof(Vertex);
+		vmaGetVirtualBlockStatistics(p.indexBlock, &stats);
+		used += stats.allocationBytes;
+	}
+	return used;
+}
+
+VkDeviceSize GeometryPool::capacityBytes() const {
+	VkDeviceSize capacity = 0;
+	for (const Page& p : pages) {
+		capacity += p.vertexBuffer.allocInfo.size + p.indexBuffer.allocInfo.size;
+	}
+	return capacity;
+}
+
+bool GeometryPool::tryAllocate(uint32_t pageIndex, uint32_t vertexCount, VkDeviceSize indexBytes, GeometryAllocation& out) {
+	Page& p = pages[pageIndex];
+
+	// the vertex block counts whole vertices, so its offsets are directly usable as vertexOffset
+	VmaVirtualAllocationCreateInfo vertexInfo = {};
+	vertexInfo.size = std::max(vertexCount, 1u);
+
+	VmaVirtualAllocation vertexAllocation;
+	VkDeviceSize firstVertex;
+	if (vmaVirtualAllocate(p.vertexBlock, &vertexInfo, &vertexAllocation, &firstVertex) != VK_SUCCESS) {
+		return false;
+	}
+
+	// 4 byte alignment keeps the offset a whole number of 16 and 32 bit indices
+	VmaVirtualAllocationCreateInfo indexInfo = {};
+	indexInfo.size = std::max<VkDeviceSize>(indexBytes, 4);
+	indexInfo.alignment = 4;
+
+	VmaVirtualAllocation indexAllocation;
+	VkDeviceSize indexOffset;
+	if (vmaVirtualAllocate(p.indexBlock, &indexInfo, &indexAllocation, &indexOffset) != VK_SUCCESS) {
+		vmaVirtualFree(p.vertexBlock, vertexAllocation);
+		return false;
+	}
+
+	out.page = pageIndex;
+	out.vertexAllocation = vertexAllocation;
+	out.indexAllocation = indexAllocation;
+	out.firstVertex = (uint32_t)firstVertex;
+	out.indexOffset = indexOffset;
+	return true;
+}
+
+void GeometryPool::addPage(uint32_t vertexSize, VkDeviceSize indexSize) {
+	Page p;
+
+	VmaAllocationCreateInfo vmaallocInfo = {};
+	vmaallocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	VkBufferCreateInfo vertexInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	vertexInfo.size = VkDeviceSize(vertexSize) * sizeof(Vertex);
+	vertexInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+	VK_CHECK(vmaCreateBuffer(allocator, &vertexInfo, &vmaallocInfo, &p.vertexBuffer.buffer, &p.vertexBuffer.allocation, &p.vertexBuffer.allocInfo));
+
+	VkBufferCreateInfo indexInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	indexInfo.size = indexSize;
+	indexInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	VK_CHECK(vmaCreateBuffer(allocator, &indexInfo, &vmaallocInfo, &p.indexBuffer.buffer, &p.indexBuffer.allocation, &p.indexBuffer.allocInfo));
+
+	VkBufferDeviceAddressInfo addrInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
+	addrInfo.buffer = p.vertexBuffer.buffer;
+	p.vertexBufferAddress = vkGetBufferDeviceAddress(device, &addrInfo);
+
+	VmaVirtualBlockCreateInfo vertexBlockInfo = {};
+	vertexBlockInfo.size = vertexSize;
+	VK_CHECK(vmaCreateVirtualBlock(&vertexBlockInfo, &p.vertexBlock));
+
+	VmaVirtualBlockCreateInfo indexBlockInfo = {};
+	indexBlockInfo.size = indexSize;
+	VK_CHECK(vmaCreateVirtualBlock(&indexBlockInfo, &p.indexBlock));
+
+	fmt::print("[CONSOLE INFO]: geometry pool page {} with {} vertices and {} index bytes\n", pages.size(), vertexSize, indexSize);
+	pages.push_back(p);
+}
@@ -0,0 +1,61 @@
+#include "vk_gltf_geometry.h"
+#include <fastgltf/glm_element_traits.hpp>
+#include <fastgltf/tools.hpp>
+
+Bounds gltf_geometry::append_primitive(fastgltf::Asset& gltf, fastgltf::Primitive& primitive, std::vector<uint32_t>& indices, std::vector<Vertex>& vertices) {
+	const size_t initialVertex = vertices.size();
+
+	const fastgltf::Accessor& indexAccessor = gltf.accessors[primitive.indicesAccessor.value()];
+	indices.reserve(indices.size() + indexAccessor.count);
+	fastgltf::iterateAccessor<uint32_t>(gltf, indexAccessor, [&](uint32_t idx) {
+		indices.push_back(idx + (uint32_t)initialVertex);
+	});
+
+	const fastgltf::Accessor& posAccessor = gltf.accessors[primitive.findAttribute("POSITION")->second];
+	vertices.resize(vertices.size() + posAccessor.count);
+	fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, posAccessor, [&](glm::vec3 v, size_t index) {
+		Vertex& vtx = vertices[initialVertex + index];
+		vtx.position = v;
+		vtx.normal = { 1, 0, 0 };
+		vtx.color = glm::vec4{ 1.f };
+		vtx.uv_x = 0;
+		vtx.uv_y = 0;
+	});
+
+	auto normals = primitive.findAttribute("NORMAL");
+	if (normals != primitive.attributes.end()) {
+		fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[normals->second], [&](glm::vec3 v, size_t index) {
+			vertices[initialVertex + index].normal = v;
+		});
+	}
+
+	auto uv = primitive.findAttribute("TEXCOORD_0");
+	if (uv != primitive.attributes.end()) {
+		fastgltf::iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[uv->second], [&](glm::vec2 v, size_t index) {
+			vertices[initialVertex + index].uv_x = v.x;
+			vertices[initialVertex + index].uv_y = v.y;
+		});
+	}
+
+	auto colors = primitive.findAttribute("COLOR_0");
+	if (colors != primitive.attributes.end()) {
+		fastgltf::iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[colors->second], [&](glm::vec4 v, size_t index) {
+			vertices[initialVertex + index].color = v;
+		});
+	}
+
+	Bounds bounds{};
+	if (vertices.size() == initialVertex) {
+		return bounds;
+	}
+	glm::vec3 minpos = vertices[initialVertex].position;
+	glm::vec3 maxpos = minpos;
+	for (size_t i = initialVertex; i < vertices.size(); i++) {
+		minpos = glm::min(minpos, vertices[i].position);
+		maxpos = glm::max(maxpos, vertices[i].position);
+	}
+	bounds.origin = (maxpos + minpos) / 2.f;
+	bounds.extents = (maxpos - minpos) / 2.f;
+	bounds.sphereRadius = glm::length(bounds.extents);
+	return bounds;
+}
@@ -0,0 +1,127 @@
+#include "vk_gpu_profiler.h"
+
+void GpuProfiler::init(VkDevice device, VkPhysicalDevice gpu, uint32_t queueFamily, uint32_t frameCount) {
+	this->device = device;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(gpu, &properties);
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(gpu, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(gpu, &familyCount, families.data());
+
+	const uint32_t validBits = families[queueFamily].timestampValidBits;
+	supported = validBits != 0 && properties.limits.timestampPeriod > 0.f;
+	if (!supported) {
+		fmt::print("[CONSOLE INFO]: timestamps unavailable on the graphics queue, gpu profiling disabled\n");
+		return;
+	}
+	timestampPeriod = properties.limits.timestampPeriod;
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	frames.resize(frameCount);
+	for (FrameQueries& f : frames) {
+		VkQueryPoolCreateInfo poolInfo = { .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = MAX_SCOPES * 2;
+		VK_CHECK(vkCreateQueryPool(device, &poolInfo, nullptr, &f.pool));
+		f.names.reserve(MAX_SCOPES);
+	}
+	timestamps.resize(MAX_SCOPES * 2);
+	sorted.reserve(HISTORY);
+}
+
+void GpuProfiler::destroy() {
+	for (FrameQueries& f : frames) {
+		vkDestroyQueryPool(device, f.pool, nullptr);
+	}
+	frames.clear();
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer cmd, uint32_t frame) {
+	if (!supported) {
+		return;
+	}
+	currentFrame = frame;
+	FrameQueries& f = frames[frame];
+	if (f.recorded) {
+		collect(f);
+	}
+
+	vkCmdResetQueryPool(cmd, f.pool, 0, MAX_SCOPES * 2);
+	f.names.clear();
+	f.recorded = true;
+}
+
+uint32_t GpuProfiler::begin(VkCommandBuffer cmd, const char* name) {
+	if (!supported) {
+		return UINT32_MAX;
+	}
+	FrameQueries& f = frames[currentFrame];
+	if (f.names.size() >= MAX_SCOPES) {
+		return UINT32_MAX;
+	}
+	uint32_t scope = (uint32_t)f.names.size();
+	f.names.push_back(name);
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, f.pool, scope * 2);
+	return scope;
+}
+
+void GpuProfiler::end(VkCommandBuffer cmd, uint32_t scope) {
+	if (scope == UINT32_MAX) {
+		return;
+	}
+	// written once every earlier command has completed
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frames[currentFrame].pool, scope * 2 + 1);
+}
+
+void GpuProfiler::collect(FrameQueries& frame) {
+	const uint32_t queryCount = (uint32_t)frame.names.size() * 2;
+	if (queryCount == 0) {
+		return;
+	}
+
+	// the fence of the frame has been waited on, anything not available was never written
+	VkResult result = vkGetQueryPoolResults(device, frame.pool, 0, queryCount, queryCount * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	uint64_t first = UINT64_MAX;
+	uint64_t last = 0;
+	for (uint32_t i = 0; i < frame.names.size(); i++) {
+		uint64_t start = timestamps[i * 2] & timestampMask;
+		uint64_t end = timestamps[i * 2 + 1] & timestampMask;
+		first = std::min(first, start);
+		last = std::max(last, end);
+		float ms = end > start ? (end - start) * timestampPeriod / 1000000.f : 0.f;
+
+		auto it = std::find_if(stats.begin(), stats.end(), [&](const ScopeStats& s) { return s.name == frame.names[i]; });
+		if (it == stats.end()) {
+			stats.push_back(ScopeStats{ frame.names[i] });
+			histories.emplace_back();
+			it = stats.end() - 1;
+		}
+		addSample(*it, histories[it - stats.begin()], ms);
+	}
+	addSample(frameStats, frameHistory, last > first ? (last - first) * timestampPeriod / 1000000.f : 0.f);
+}
+
+void GpuProfiler::addSample(ScopeStats& scope, History& history, float ms) {
+	history.samples[history.next] = ms;
+	history.next = (history.next + 1) % HISTORY;
+	history.count = std::min(history.count + 1, HISTORY);
+
+	sorted.assign(history.samples.begin(), history.samples.begin() + history.count);
+	float sum = 0.f;
+	for (float s : sorted) {
+		sum += s;
+	}
+	size_t p99 = (sorted.size() * 99) / 100;
+	std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+
+	scope.lastMs = ms;
+	scope.averageMs = sum / history.count;
+	scope.p99Ms = sorted[p99];
+}
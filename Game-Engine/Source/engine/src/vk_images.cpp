@@ -1,16 +1,20 @@
 #include "vk_images.h"
 #include "vk_initializers.h"
+#include "vk_barriers.h"
 
 namespace vkutil {
 	void transition_image(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout) {
 		VkImageMemoryBarrier2 imageBarrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
 		imageBarrier.pNext = nullptr;
 
-		imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-		imageBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
-		imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-		imageBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT;
-		
+		// masks follow from the layouts, use BarrierTracker when the previous use is not implied by the layout
+		ImageState src = imagestate::from_layout(currentLayout);
+		ImageState dst = imagestate::from_layout(newLayout);
+		imageBarrier.srcStageMask = src.stages;
+		imageBarrier.srcAccessMask = src.access & imagestate::WRITE_ACCESS;
+		imageBarrier.dstStageMask = dst.stages;
+		imageBarrier.dstAccessMask = dst.access;
+
 		imageBarrier.oldLayout = currentLayout;
 		imageBarrier.newLayout = newLayout;
 
@@ -69,11 +73,12 @@ namespace vkutil {
 			halfSize.width /= 2;
 			halfSize.height /= 2;
 
+			// the copy or blit that filled this mip has to finish before it is read by the next blit
 			VkImageMemoryBarrier2 imageBarrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
-			imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-			imageBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
-			imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-			imageBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT;
+			imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+			imageBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+			imageBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
 
 			imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 			imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
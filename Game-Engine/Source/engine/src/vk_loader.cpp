@@ -4,6 +4,8 @@
 #include "vk_engine.h"
 #include "vk_initializers.h"
 #include "vk_types.h"
+#include "vk_lod.h"
+#include "vk_gltf_geometry.h"
 #include <glm/gtx/quaternion.hpp>
 #include <fastgltf/glm_element_traits.hpp>
 #include <fastgltf/parser.hpp>
@@ -11,6 +13,8 @@
 #include <fastgltf/util.hpp>
 
 const std::filesystem::path MODEL_ROOT = "Source/models";
+// simplification may move the surface by at most this fraction of its bounding sphere radius
+constexpr float LOD_MAX_RELATIVE_ERROR = 0.05f;
 
 constexpr std::string_view to_string(fastgltf::Error e) noexcept {
     using E = fastgltf::Error;
@@ -32,39 +36,38 @@ constexpr std::string_view to_string(fastgltf::Error e) noexcept {
 }
 
 void LoadedGLTF::Draw(const glm::mat4& topMatrix, DrawContext& ctx) {
-    for (auto& node : topNodes) {
-        node->Draw(topMatrix, ctx);
-    }
+    // no-op unless a node was moved since the last frame
+    graph.updateTransforms(&creator->threadPool);
+    graph.draw(creator->assets, topMatrix, ctx);
 }
 
 void LoadedGLTF::clearAll()
 {
-    VkDevice dv = creator->driver;
+    // frames in flight may still draw this file, everything is released against the last submitted frame
+    const uint64_t safeAfter = (uint64_t)creator->frameNumber;
 
-    for (auto& [k, v] : meshes) {
+    // the list refers to this file's meshes and materials
+    graph.removeFromRenderList();
 
-        creator->destroyBuffer(v->meshBuffers.indexBuffer);
-        creator->destroyBuffer(v->meshBuffers.vertexBuffer);
+    for (MeshHandle mesh : ownedMeshes) {
+        creator->assets.meshes.release(mesh, safeAfter);
     }
 
-    for (auto& [k, v] : images) {
+    for (ImageHandle image : ownedImages) {
+        creator->assets.images.release(image, safeAfter);
+    }
 
-        if (v.image == creator->errorTexture.image) {
-            continue;
-        }
-        creator->destroyImage(v);
+    for (MaterialHandle material : ownedMaterials) {
+        creator->assets.materials.release(material, safeAfter);
     }
 
     for (auto& sampler : samplers) {
-        vkDestroySampler(dv, sampler, nullptr);
+        creator->deferredDeletion.destroySampler(sampler, safeAfter);
     }
 
-    auto materialBuffer = materialDataBuffer;
-    auto samplersToDestroy = samplers;
+    descriptorPool.destroyPools(creator->deferredDeletion, safeAfter);
 
-    descriptorPool.destroyPools(dv);
-
-    creator->destroyBuffer(materialBuffer);
+    creator->deferredDeletion.destroyBuffer(materialDataBuffer, safeAfter);
 }
 
 VkFilter extract_filter(fastgltf::Filter filter)
@@ -98,7 +101,38 @@ VkSamplerMipmapMode extract_mipmap_mode(fastgltf::Filter filter)
 }
 
 
-std::optional<std::vector<std::shared_ptr<MeshAsset>>> load_gltf_meshes(VulkanEngine* engine, const std::filesystem::path& path) {
+// appends the simplified index ranges of a surface after the indices of the whole mesh loaded so far
+void generate_lods(std::vector<uint32_t>& indices, std::span<const Vertex> vertices, GeoSurface& surface) {
+    surface.lods[0] = { surface.startIndex, surface.count };
+    surface.lodCount = 1;
+
+    std::vector<uint32_t> source(indices.begin() + surface.startIndex, indices.begin() + surface.startIndex + surface.count);
+    const float maxError = surface.bounds.sphereRadius * LOD_MAX_RELATIVE_ERROR;
+
+    while (surface.lodCount < MAX_MESH_LODS) {
+        std::vector<uint32_t> simplified = lod::simplify(source, vertices, source.size() / 2, maxError);
+
+        // stop once the simplifier cant remove a meaningful amount of triangles within the error budget
+        if (simplified.empty() || simplified.size() > source.size() * 3 / 4) {
+            break;
+        }
+
+        surface.lods[surface.lodCount++] = { (uint32_t)indices.size(), (uint32_t)simplified.size() };
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        source = std::move(simplified);
+    }
+}
+
+// clusters the full detail range of a surface into meshlets, small surfaces are left to the regular draw path
+void generate_meshlets(std::vector<uint32_t>& indices, std::span<const Vertex> vertices, GeoSurface& surface, bool coneCulling, MeshletData& meshlets) {
+    if (surface.count / 3 < MESHLET_MIN_SURFACE_TRIANGLES) {
+        return;
+    }
+    surface.meshletOffset = (uint32_t)meshlets.meshlets.size();
+    surface.meshletCount = meshlet::build(indices, surface.startIndex, surface.count, vertices, coneCulling, meshlets);
+}
+
+std::optional<std::vector<MeshHandle>> load_gltf_meshes(VulkanEngine* engine, const std::filesystem::path& path) {
         std::filesystem::path filePath = MODEL_ROOT / path;
 
         fmt::print("Loading GLTF file {}\n", (MODEL_ROOT / path).string());
@@ -121,7 +155,7 @@ std::optional<std::vector<std::shared_ptr<MeshAsset>>> load_gltf_meshes(VulkanEn
             return {};
         }
 
-        std::vector<std::shared_ptr<MeshAsset>> meshes;
+        std::vector<MeshHandle> meshes;
 
         // use the same vectors for all meshes so that the memory doesnt reallocate as
         // often
@@ -135,72 +169,17 @@ std::optional<std::vector<std::shared_ptr<MeshAsset>>> load_gltf_meshes(VulkanEn
             // clear the mesh arrays each mesh, we dont want to merge them by error
             indices.clear();
             vertices.clear();
+            MeshletData meshlets;
 
             for (auto&& p : mesh.primitives) {
                 GeoSurface newSurface;
                 newSurface.startIndex = (uint32_t)indices.size();
                 newSurface.count = (uint32_t)gltf.accessors[p.indicesAccessor.value()].count;
 
-                size_t initial_vtx = vertices.size();
-
-                // load indexes
-                {
-                    fastgltf::Accessor& indexaccessor = gltf.accessors[p.indicesAccessor.value()];
-                    indices.reserve(indices.size() + indexaccessor.count);
-
-                    fastgltf::iterateAccessor<uint32_t>(gltf, indexaccessor,
-                        [&](uint32_t idx) {
-                            indices.push_back(idx + static_cast<uint32_t>(initial_vtx));
-                        });
-                }
-
-                // load vertex positions
-                {
-                    fastgltf::Accessor& posAccessor = gltf.accessors[p.findAttribute("POSITION")->second];
-                    vertices.resize(vertices.size() + posAccessor.count);
-
-                    fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, posAccessor,
-                        [&](glm::vec3 v, size_t index) {
-                            Vertex newvtx;
-                            newvtx.position = v;
-                            newvtx.normal = { 1, 0, 0 };
-                            newvtx.color = glm::vec4{ 1.f };
-                            newvtx.uv_x = 0;
-                            newvtx.uv_y = 0;
-                            vertices[initial_vtx + index] = newvtx;
-                        });
-                }
-
-                // load vertex normals
-                auto normals = p.findAttribute("NORMAL");
-                if (normals != p.attributes.end()) {
-
-                    fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[(*normals).second],
-                        [&](glm::vec3 v, size_t index) {
-                            vertices[initial_vtx + index].normal = v;
-                        });
-                }
-
-                // load UVs
-                auto uv = p.findAttribute("TEXCOORD_0");
-                if (uv != p.attributes.end()) {
-
-                    fastgltf::iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[(*uv).second],
-                        [&](glm::vec2 v, size_t index) {
-                            vertices[initial_vtx + index].uv_x = v.x;
-                            vertices[initial_vtx + index].uv_y = v.y;
-                        });
-                }
-
-                // load vertex colors
-                auto colors = p.findAttribute("COLOR_0");
-                if (colors != p.attributes.end()) {
+                newSurface.bounds = gltf_geometry::append_primitive(gltf, p, indices, vertices);
 
-                    fastgltf::iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[(*colors).second],
-                        [&](glm::vec4 v, size_t index) {
-                            vertices[initial_vtx + index].color = v;
-                        });
-                }
+                generate_lods(indices, vertices, newSurface);
+                generate_meshlets(indices, vertices, newSurface, true, meshlets);
                 newmesh.surfaces.push_back(newSurface);
             }
 
@@ -216,17 +195,22 @@ std::optional<std::vector<std::shared_ptr<MeshAsset>>> load_gltf_meshes(VulkanEn
                 }
             }
             newmesh.meshBuffers = engine->uploadMesh(indices, vertices);
+            if (!meshlets.meshlets.empty()) {
+                engine->uploadMeshlets(newmesh.meshBuffers, meshlets);
+            }
 
-            meshes.emplace_back(std::make_shared<MeshAsset>(std::move(newmesh)));
+            meshes.push_back(engine->assets.meshes.add(std::move(newmesh)));
         }
 
         return meshes;
     }
 
-std::optional<AllocatedImage> load_image(VulkanEngine* engine, fastgltf::Asset& asset, fastgltf::Image& image) {
-        AllocatedImage newImage{};
+GLTFSceneData::Image decode_image(fastgltf::Asset& asset, fastgltf::Image& image) {
+        GLTFSceneData::Image decoded;
+        decoded.name = image.name;
 
         int width, height, nrChannels;
+        unsigned char* data = nullptr;
 
         std::visit(
             fastgltf::visitor{
@@ -237,29 +221,11 @@ std::optional<AllocatedImage> load_image(VulkanEngine* engine, fastgltf::Asset&
                 assert(filePath.uri.isLocalPath());
 
                 const std::string path(filePath.uri.path().begin(), filePath.uri.path().end());
-                unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 4);
-                if (data) {
-                    VkExtent3D imageSize;
-                    imageSize.width = width;
-                    imageSize.height = height;
-                    imageSize.depth = 1;
-
-                    newImage = engine->createImage(data, imageSize, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
-                    stbi_image_free(data);
-                }
+                data = stbi_load(path.c_str(), &width, &height, &nrChannels, 4);
             },
 
             [&](fastgltf::sources::Vector& vector) {
-                 unsigned char* data = stbi_load_from_memory(vector.bytes.data(), static_cast<int>(vector.bytes.size()), &width, &height, &nrChannels, 4);
-                 if (data) {
-                     VkExtent3D imageSize;
-                     imageSize.width = width;
-                     imageSize.height = height;
-                     imageSize.depth = 1;
-
-                     newImage = engine->createImage(data, imageSize, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
-                     stbi_image_free(data);
-                 }
+                data = stbi_load_from_memory(vector.bytes.data(), static_cast<int>(vector.bytes.size()), &width, &height, &nrChannels, 4);
             },
 
             [&](fastgltf::sources::BufferView& view) {
@@ -269,34 +235,23 @@ std::optional<AllocatedImage> load_image(VulkanEngine* engine, fastgltf::Asset&
                 std::visit(fastgltf::visitor{
                     [](auto& arg) {},
                     [&](fastgltf::sources::Vector& vector) {
-                        unsigned char* data = stbi_load_from_memory(vector.bytes.data() + bufferView.byteOffset, static_cast<int>(bufferView.byteLength), &width, &height, &nrChannels, 4);
-                        if (data) {
-                            VkExtent3D imageSize{};
-                            imageSize.width = width;
-                            imageSize.height = height;
-                            imageSize.depth = 1;
-                            newImage = engine->createImage(data, imageSize, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
-                            stbi_image_free(data);
-                        }
+                        data = stbi_load_from_memory(vector.bytes.data() + bufferView.byteOffset, static_cast<int>(bufferView.byteLength), &width, &height, &nrChannels, 4);
                     } },
                     buffer.data);
             } },
             image.data);
 
-        if (newImage.image == VK_NULL_HANDLE) {
-            return{};
-        }
-        else {
-            return newImage;
+        if (data) {
+            decoded.extent = VkExtent3D{ (uint32_t)width, (uint32_t)height, 1 };
+            decoded.pixels = { data, stbi_image_free };
         }
+        return decoded;
     }
 
-std::optional<std::shared_ptr<LoadedGLTF>> load_gltf(VulkanEngine* engine, const std::filesystem::path& name) {
+std::optional<GLTFSceneData> parse_gltf(const std::filesystem::path& name) {
+        CORE_PROFILE_FUNCTION();
         std::filesystem::path path = MODEL_ROOT / name;
         fmt::print("[INFO] Loading GLTF: {}\n", path.string());
-        std::shared_ptr<LoadedGLTF> scene = std::make_shared<LoadedGLTF>();
-        scene->creator = engine;
-        LoadedGLTF& file = *scene.get();
         fastgltf::Parser parser{};
 
         constexpr auto gltfOptions = fastgltf::Options::DontRequireValidAssetMember
@@ -333,211 +288,70 @@ std::optional<std::shared_ptr<LoadedGLTF>> load_gltf(VulkanEngine* engine, const
             return {};
         }
 
-        std::vector<DynamicDescriptorAllocator::PoolSizeRatio> sizes = {
-            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3 },
-            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3 },
-            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 }
-        };
-
-        file.descriptorPool.init(engine->driver, gltf.materials.size(), sizes);
-
-        VkSamplerCreateInfo sampl = { .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+        GLTFSceneData scene;
 
         for (fastgltf::Sampler& sampler : gltf.samplers) {
+            VkSamplerCreateInfo sampl = { .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
             sampl.maxLod = VK_LOD_CLAMP_NONE;
             sampl.minLod = 0;
             sampl.magFilter = extract_filter(sampler.magFilter.value_or(fastgltf::Filter::Nearest));
             sampl.minFilter = extract_filter(sampler.minFilter.value_or(fastgltf::Filter::Nearest));
             sampl.mipmapMode = extract_mipmap_mode(sampler.minFilter.value_or(fastgltf::Filter::Nearest));
-
-            VkSampler newSampler;
-            VK_CHECK(vkCreateSampler(engine->driver, &sampl, nullptr, &newSampler));
-            file.samplers.push_back(newSampler);
+            scene.samplers.push_back(sampl);
         }
 
-        std::vector<std::shared_ptr<MeshAsset>> meshes;
-        std::vector<std::shared_ptr<Node>> nodes;
-        std::vector<AllocatedImage> images;
-        std::vector<std::shared_ptr<GLTFMaterial>> materials;
-
         for (fastgltf::Image& image : gltf.images) {
-            std::optional<AllocatedImage> img = load_image(engine, gltf, image);
-
-            if (img.has_value()) {
-                images.push_back(*img);
-                file.images[image.name.c_str()] = *img;
-            }
-            else {
-                images.push_back(engine->errorTexture);
-                fmt::print("[GLTF ERROR] failed to load texture {}\n", image.name);
-            }
+            scene.images.push_back(decode_image(gltf, image));
         }
 
-        file.materialDataBuffer = engine->createBuffer(sizeof(GLTFMetallic_Roughness::MaterialConstants) * gltf.materials.size(), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-        int data_index = 0;
-        GLTFMetallic_Roughness::MaterialConstants* sceneMaterialConstants = (GLTFMetallic_Roughness::MaterialConstants*)file.materialDataBuffer.allocInfo.pMappedData;
-
         for (fastgltf::Material& mat : gltf.materials) {
-            std::shared_ptr<GLTFMaterial> newMat = std::make_shared<GLTFMaterial>();
-            materials.push_back(newMat);
-            file.materials[mat.name.c_str()] = newMat;
-
-            GLTFMetallic_Roughness::MaterialConstants constants;
-            constants.colorFactor.x = mat.pbrData.baseColorFactor[0];
-            constants.colorFactor.y = mat.pbrData.baseColorFactor[1];
-            constants.colorFactor.z = mat.pbrData.baseColorFactor[2];
-            constants.colorFactor.w = mat.pbrData.baseColorFactor[3];
-
-            constants.metalRoughFactor.x = mat.pbrData.metallicFactor;
-            constants.metalRoughFactor.y = mat.pbrData.roughnessFactor;
+            GLTFSceneData::Material& material = scene.materials.emplace_back();
+            material.name = mat.name.c_str();
+            material.colorFactor = glm::vec4(mat.pbrData.baseColorFactor[0], mat.pbrData.baseColorFactor[1],
+                mat.pbrData.baseColorFactor[2], mat.pbrData.baseColorFactor[3]);
+            material.metalRoughFactor = glm::vec4(mat.pbrData.metallicFactor, mat.pbrData.roughnessFactor, 0.f, 0.f);
 
-            sceneMaterialConstants[data_index] = constants;
-
-            MaterialPass passType = MaterialPass::MAIN_COLOR;
+            material.passType = MaterialPass::MAIN_COLOR;
             if (mat.alphaMode == fastgltf::AlphaMode::Blend) {
-                passType = MaterialPass::TRASNPARENT;
+                material.passType = MaterialPass::TRASNPARENT;
             }
 
-            GLTFMetallic_Roughness::MaterialResources materialResources;
-            materialResources.colorImage = engine->whiteImage;
-            materialResources.colorSampler = engine->defaultSamplerLinear;
-            materialResources.metalRoughImage = engine->whiteImage;
-            materialResources.metalRoughSampler = engine->defaultSamplerLinear;
-
-            materialResources.dataBuffer = file.materialDataBuffer.buffer;
-            materialResources.bufferOffset = data_index * sizeof(GLTFMetallic_Roughness::MaterialConstants);
             if (mat.pbrData.baseColorTexture.has_value()) {
-                size_t img = gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex].imageIndex.value();
-                size_t sampler = gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex].samplerIndex.value();
-
-                materialResources.colorImage = images[img];
-                materialResources.colorSampler = file.samplers[sampler];
+                material.colorImage = (uint32_t)gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex].imageIndex.value();
+                material.colorSampler = (uint32_t)gltf.textures[mat.pbrData.baseColorTexture.value().textureIndex].samplerIndex.value();
             }
-            newMat->data = engine->metalRoughMat.writeMaterial(engine->driver, passType, materialResources, file.descriptorPool);
-
-            data_index++;
         }
 
-        std::vector<uint32_t> indices;
-        std::vector<Vertex> vertices;
-
         for (fastgltf::Mesh& mesh : gltf.meshes) {
-            std::shared_ptr<MeshAsset> newmesh = std::make_shared<MeshAsset>();
-            meshes.push_back(newmesh);
-            file.meshes[mesh.name.c_str()] = newmesh;
-            newmesh->name = mesh.name;
-
-            // clear the mesh arrays each mesh, we dont want to merge them by error
-            indices.clear();
-            vertices.clear();
+            GLTFSceneData::Mesh& newmesh = scene.meshes.emplace_back();
+            newmesh.name = mesh.name;
 
             for (auto&& p : mesh.primitives) {
                 GeoSurface newSurface;
-                newSurface.startIndex = (uint32_t)indices.size();
+                newSurface.startIndex = (uint32_t)newmesh.indices.size();
                 newSurface.count = (uint32_t)gltf.accessors[p.indicesAccessor.value()].count;
 
-                size_t initial_vtx = vertices.size();
-
-                // load indexes
-                {
-                    fastgltf::Accessor& indexaccessor = gltf.accessors[p.indicesAccessor.value()];
-                    indices.reserve(indices.size() + indexaccessor.count);
-
-                    fastgltf::iterateAccessor<std::uint32_t>(gltf, indexaccessor,
-                        [&](std::uint32_t idx) {
-                            indices.push_back(idx + initial_vtx);
-                        });
-                }
+                newSurface.bounds = gltf_geometry::append_primitive(gltf, p, newmesh.indices, newmesh.vertices);
 
-                // load vertex positions
-                {
-                    fastgltf::Accessor& posAccessor = gltf.accessors[p.findAttribute("POSITION")->second];
-                    vertices.resize(vertices.size() + posAccessor.count);
-
-                    fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, posAccessor,
-                        [&](glm::vec3 v, size_t index) {
-                            Vertex newvtx;
-                            newvtx.position = v;
-                            newvtx.normal = { 1, 0, 0 };
-                            newvtx.color = glm::vec4{ 1.f };
-                            newvtx.uv_x = 0;
-                            newvtx.uv_y = 0;
-                            vertices[initial_vtx + index] = newvtx;
-                        });
-                }
-
-                // load vertex normals
-                auto normals = p.findAttribute("NORMAL");
-                if (normals != p.attributes.end()) {
-
-                    fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[(*normals).second],
-                        [&](glm::vec3 v, size_t index) {
-                            vertices[initial_vtx + index].normal = v;
-                        });
-                }
-
-                // load UVs
-                auto uv = p.findAttribute("TEXCOORD_0");
-                if (uv != p.attributes.end()) {
-
-                    fastgltf::iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[(*uv).second],
-                        [&](glm::vec2 v, size_t index) {
-                            vertices[initial_vtx + index].uv_x = v.x;
-                            vertices[initial_vtx + index].uv_y = v.y;
-                        });
-                }
-
-                // load vertex colors
-                auto colors = p.findAttribute("COLOR_0");
-                if (colors != p.attributes.end()) {
-
-                    fastgltf::iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[(*colors).second],
-                        [&](glm::vec4 v, size_t index) {
-                            vertices[initial_vtx + index].color = v;
-                        });
-                }
-
-                if (p.materialIndex.has_value()) {
-                    newSurface.material = materials[p.materialIndex.value()];
-                }
-                else {
-                    newSurface.material = materials[0];
-                }
-
-                glm::vec3 minpos = vertices[initial_vtx].position;
-                glm::vec3 maxpos = vertices[initial_vtx].position;
-                for (int i = initial_vtx; i < vertices.size(); i++) {
-                    minpos = glm::min(minpos, vertices[i].position);
-                    maxpos = glm::max(maxpos, vertices[i].position);
-                }
-
-                newSurface.bounds.origin = (maxpos + minpos) / 2.f;
-                newSurface.bounds.extents = (maxpos - minpos) / 2.f;
-                newSurface.bounds.sphereRadius = glm::length(newSurface.bounds.extents);
-
-                newmesh->surfaces.push_back(newSurface);
+                generate_lods(newmesh.indices, newmesh.vertices, newSurface);
+                // back faces of double sided materials are visible, so their clusters cant be rejected by normal cone
+                bool doubleSided = p.materialIndex.has_value() && gltf.materials[p.materialIndex.value()].doubleSided;
+                generate_meshlets(newmesh.indices, newmesh.vertices, newSurface, !doubleSided, newmesh.meshlets);
+                newmesh.surfaces.push_back(newSurface);
+                newmesh.surfaceMaterials.push_back(p.materialIndex.has_value() ? (uint32_t)p.materialIndex.value() : 0);
             }
-
-            newmesh->meshBuffers = engine->uploadMesh(indices, vertices);
         }
 
-        for (fastgltf::Node& node : gltf.nodes) {
-            std::shared_ptr<Node> newNode;
-            if (node.meshIndex.has_value()) {
-                newNode = std::make_shared<MeshNode>();
-                static_cast<MeshNode*>(newNode.get())->mesh = meshes[*node.meshIndex];
-            }
-            else {
-                newNode = std::make_shared<Node>();
-            }
+        std::vector<glm::mat4> localTransforms(gltf.nodes.size());
+        std::vector<uint32_t> parents(gltf.nodes.size(), SceneGraph::NO_PARENT);
 
-            nodes.push_back(newNode);
-            file.nodes[node.name.c_str()];
+        for (size_t i = 0; i < gltf.nodes.size(); i++) {
+            fastgltf::Node& node = gltf.nodes[i];
 
             std::visit(fastgltf::visitor{
 
                 [&](fastgltf::Node::TransformMatrix matrix) {
-                    memcpy(&newNode->localTransform, matrix.data(), sizeof(matrix));
+                    memcpy(&localTransforms[i], matrix.data(), sizeof(matrix));
                 },
 
                 [&](fastgltf::Node::TRS transform) {
@@ -550,28 +364,191 @@ std::optional<std::shared_ptr<LoadedGLTF>> load_gltf(VulkanEngine* engine, const
                     glm::mat4 tm = glm::translate(glm::mat4(1.f), tl);
                     glm::mat4 rm = glm::toMat4(rot);
                     glm::mat4 sm = glm::scale(glm::mat4(1.f), sc);
-                    newNode->localTransform = tm * rm * sm;
+                    localTransforms[i] = tm * rm * sm;
                 }
 
             }, node.transform);
+
+            for (auto& c : node.children) {
+                parents[c] = (uint32_t)i;
+            }
         }
 
-        for (int i = 0; i < gltf.nodes.size(); i++) {
+        // breadth first from the roots, so the graph stores parents before children one depth level at a time
+        std::vector<size_t> order;
+        order.reserve(gltf.nodes.size());
+        for (size_t i = 0; i < gltf.nodes.size(); i++) {
+            if (parents[i] == SceneGraph::NO_PARENT) {
+                order.push_back(i);
+            }
+        }
+
+        std::vector<uint32_t> nodeIndex(gltf.nodes.size(), SceneGraph::NO_PARENT);
+        for (size_t o = 0; o < order.size(); o++) {
+            size_t i = order[o];
             fastgltf::Node& node = gltf.nodes[i];
-            std::shared_ptr<Node>& sceneNode = nodes[i];
 
-            for (auto& c : node.children) {
-                sceneNode->children.push_back(nodes[c]);
-                nodes[c]->parent = sceneNode;
+            nodeIndex[i] = (uint32_t)scene.nodes.size();
+            GLTFSceneData::Node& newNode = scene.nodes.emplace_back();
+            newNode.name = node.name.c_str();
+            newNode.parent = parents[i] == SceneGraph::NO_PARENT ? SceneGraph::NO_PARENT : nodeIndex[parents[i]];
+            newNode.localTransform = localTransforms[i];
+            newNode.mesh = node.meshIndex.has_value() ? (uint32_t)*node.meshIndex : UINT32_MAX;
+
+            order.insert(order.end(), node.children.begin(), node.children.end());
+        }
+
+        return scene;
+    }
+
+GLTFUpload::GLTFUpload(VulkanEngine* engine, GLTFSceneData data)
+    : engine(engine), data(std::move(data)) {
+        file = std::make_shared<LoadedGLTF>();
+        file->creator = engine;
+
+        for (const VkSamplerCreateInfo& sampl : this->data.samplers) {
+            VkSampler newSampler;
+            VK_CHECK(vkCreateSampler(engine->driver, &sampl, nullptr, &newSampler));
+            file->samplers.push_back(newSampler);
+        }
+
+        std::vector<DynamicDescriptorAllocator::PoolSizeRatio> sizes = {
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3 },
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3 },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 }
+        };
+
+        const size_t materialCount = std::max<size_t>(this->data.materials.size(), 1);
+        file->descriptorPool.init(engine->driver, (uint32_t)materialCount, sizes);
+        file->materialDataBuffer = engine->createBuffer(sizeof(GLTFMetallic_Roughness::MaterialConstants) * materialCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    }
+
+bool GLTFUpload::step(VkCommandBuffer cmd, std::vector<AllocatedBuffer>& staging, size_t byteBudget) {
+        CORE_PROFILE_FUNCTION();
+        if (done) {
+            return true;
+        }
+        size_t bytes = 0;
+
+        while (nextImage < data.images.size()) {
+            if (bytes >= byteBudget) {
+                return false;
+            }
+            GLTFSceneData::Image& image = data.images[nextImage++];
+            if (image.pixels) {
+                AllocatedImage newImage = engine->createImage(cmd, image.pixels.get(), image.extent, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT, false, staging);
+                images.push_back(newImage);
+                ImageHandle handle = engine->assets.images.add(newImage);
+                file->ownedImages.push_back(handle);
+                file->images[image.name] = handle;
+                bytes += (size_t)image.extent.width * image.extent.height * 4;
+                image.pixels.reset();
+            }
+            else {
+                images.push_back(engine->errorTexture);
+                fmt::print("[GLTF ERROR] failed to load texture {}\n", image.name);
             }
         }
 
-        for (auto& node : nodes) {
-            if (node->parent.lock() == nullptr) {
-                file.topNodes.push_back(node);
-                node->refreshTransform(glm::mat4{ 1.f });
+        if (!materialsCreated) {
+            createMaterials();
+            materialsCreated = true;
+        }
+
+        while (nextMesh < data.meshes.size()) {
+            if (bytes >= byteBudget) {
+                return false;
+            }
+            GLTFSceneData::Mesh& mesh = data.meshes[nextMesh++];
+
+            MeshAsset newmesh;
+            newmesh.name = mesh.name;
+            newmesh.surfaces = std::move(mesh.surfaces);
+            for (size_t i = 0; i < newmesh.surfaces.size(); i++) {
+                // files without materials draw with the engine default
+                newmesh.surfaces[i].material = materials.empty() ? engine->defaultMat : materials[mesh.surfaceMaterials[i]];
+            }
+
+            newmesh.meshBuffers = engine->uploadMesh(cmd, mesh.indices, mesh.vertices, staging);
+            bytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(uint32_t);
+            if (!mesh.meshlets.meshlets.empty()) {
+                engine->uploadMeshlets(cmd, newmesh.meshBuffers, mesh.meshlets, staging);
+                bytes += mesh.meshlets.meshlets.size() * sizeof(GPUMeshlet) + mesh.meshlets.vertices.size() * sizeof(uint32_t) + mesh.meshlets.triangles.size();
             }
+            // the cpu copy is no longer needed once recorded
+            mesh.indices = {};
+            mesh.vertices = {};
+            mesh.meshlets = {};
+
+            MeshHandle handle = engine->assets.meshes.add(std::move(newmesh));
+            meshes.push_back(handle);
+            file->ownedMeshes.push_back(handle);
+            file->meshes[mesh.name] = handle;
         }
 
-        return scene;
-    }
\ No newline at end of file
+        buildGraph();
+        done = true;
+        return true;
+    }
+
+void GLTFUpload::createMaterials() {
+        GLTFMetallic_Roughness::MaterialConstants* sceneMaterialConstants = (GLTFMetallic_Roughness::MaterialConstants*)file->materialDataBuffer.allocInfo.pMappedData;
+
+        for (size_t data_index = 0; data_index < data.materials.size(); data_index++) {
+            const GLTFSceneData::Material& mat = data.materials[data_index];
+
+            GLTFMetallic_Roughness::MaterialConstants constants;
+            constants.colorFactor = mat.colorFactor;
+            constants.metalRoughFactor = mat.metalRoughFactor;
+            sceneMaterialConstants[data_index] = constants;
+
+            GLTFMetallic_Roughness::MaterialResources materialResources;
+            materialResources.colorImage = engine->whiteImage;
+            materialResources.colorSampler = engine->defaultSamplerLinear;
+            materialResources.metalRoughImage = engine->whiteImage;
+            materialResources.metalRoughSampler = engine->defaultSamplerLinear;
+
+            materialResources.dataBuffer = file->materialDataBuffer.buffer;
+            materialResources.bufferOffset = (uint32_t)(data_index * sizeof(GLTFMetallic_Roughness::MaterialConstants));
+            if (mat.colorImage != UINT32_MAX) {
+                materialResources.colorImage = images[mat.colorImage];
+                materialResources.colorSampler = file->samplers[mat.colorSampler];
+            }
+
+            MaterialHandle newMat = engine->assets.materials.add(engine->metalRoughMat.writeMaterial(engine->driver, mat.passType, materialResources, file->descriptorPool));
+            materials.push_back(newMat);
+            file->ownedMaterials.push_back(newMat);
+            file->materials[mat.name] = newMat;
+        }
+    }
+
+void GLTFUpload::buildGraph() {
+        for (const GLTFSceneData::Node& node : data.nodes) {
+            MeshHandle mesh = node.mesh != UINT32_MAX ? meshes[node.mesh] : MeshHandle{};
+            uint32_t index = file->graph.addNode(node.parent, node.localTransform, mesh);
+            if (!node.name.empty()) {
+                file->nodes[node.name] = index;
+            }
+        }
+
+        file->graph.updateTransforms();
+    }
+
+std::optional<std::shared_ptr<LoadedGLTF>> load_gltf(VulkanEngine* engine, const std::filesystem::path& name) {
+        std::optional<GLTFSceneData> data = parse_gltf(name);
+        if (!data.has_value()) {
+            return {};
+        }
+
+        // everything in one submission, waited on
+        GLTFUpload upload(engine, std::move(*data));
+        std::vector<AllocatedBuffer> staging;
+        engine->immediate_cmd([&](VkCommandBuffer cmd) {
+            upload.step(cmd, staging, SIZE_MAX);
+            });
+        for (const AllocatedBuffer& buffer : staging) {
+            engine->destroyBuffer(buffer);
+        }
+
+        return upload.scene();
+    }
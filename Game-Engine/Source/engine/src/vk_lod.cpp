@@ -0,0 +1,262 @@
+#include "vk_lod.h"
+#include <cfloat>
+#include <queue>
+#include <unordered_map>
+#include <glm/geometric.hpp>
+
+namespace {
+	struct Quadric {
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+
+		void addPlane(const glm::dvec3& n, double d, double weight) {
+			a2 += weight * n.x * n.x; ab += weight * n.x * n.y; ac += weight * n.x * n.z; ad += weight * n.x * d;
+			b2 += weight * n.y * n.y; bc += weight * n.y * n.z; bd += weight * n.y * d;
+			c2 += weight * n.z * n.z; cd += weight * n.z * d;
+			d2 += weight * d * d;
+			this->weight += weight;
+		}
+
+		Quadric& operator+=(const Quadric& o) {
+			a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+			b2 += o.b2; bc += o.bc; bd += o.bd;
+			c2 += o.c2; cd += o.cd;
+			d2 += o.d2;
+			weight += o.weight;
+			return *this;
+		}
+
+		double error(const glm::dvec3& p) const {
+			double e = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+				+ b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+				+ c2 * p.z * p.z + 2 * cd * p.z
+				+ d2;
+			// area weighted mean of the squared plane distances
+			return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+		}
+	};
+
+	struct Collapse {
+		double cost;
+		uint32_t src;
+		uint32_t dst;
+
+		bool operator>(const Collapse& o) const { return cost > o.cost; }
+	};
+
+	struct Simplifier {
+		std::vector<glm::dvec3> positions;
+		std::vector<Quadric> quadrics;
+		std::vector<uint8_t> locked;
+		std::vector<uint32_t> remap;
+		std::vector<std::array<uint32_t, 3>> triangles;
+		std::vector<uint8_t> triangleAlive;
+		std::vector<std::vector<uint32_t>> vertexTriangles;
+
+		uint32_t find(uint32_t v) {
+			while (remap[v] != v) {
+				remap[v] = remap[remap[v]];
+				v = remap[v];
+			}
+			return v;
+		}
+
+		double cost(uint32_t src, uint32_t dst) const {
+			Quadric q = quadrics[src];
+			q += quadrics[dst];
+			return q.error(positions[dst]);
+		}
+
+		bool bestCollapse(uint32_t u, uint32_t v, Collapse& out) const {
+			bool canU = !locked[u];
+			bool canV = !locked[v];
+			if (!canU && !canV) {
+				return false;
+			}
+			double costUV = canU ? cost(u, v) : DBL_MAX;
+			double costVU = canV ? cost(v, u) : DBL_MAX;
+			out = costUV <= costVU ? Collapse{ costUV, u, v } : Collapse{ costVU, v, u };
+			return true;
+		}
+
+		// rejects collapses that would fold a surrounding triangle over
+		bool flips(uint32_t src, uint32_t dst) const {
+			for (uint32_t t : vertexTriangles[src]) {
+				if (!triangleAlive[t]) {
+					continue;
+				}
+				const auto& tri = triangles[t];
+				if (tri[0] == dst || tri[1] == dst || tri[2] == dst) {
+					continue;
+				}
+
+				glm::dvec3 p[3];
+				glm::dvec3 moved[3];
+				for (int c = 0; c < 3; c++) {
+					p[c] = positions[tri[c]];
+					moved[c] = tri[c] == src ? positions[dst] : p[c];
+				}
+
+				glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				glm::dvec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+				double lenBefore = glm::length(before);
+				double lenAfter = glm::length(after);
+				if (lenAfter <= 1e-12 * std::max(lenBefore, 1e-12)) {
+					return true;
+				}
+				if (glm::dot(before, after) < 0.25 * lenBefore * lenAfter) {
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+}
+
+std::vector<uint32_t> lod::simplify(std::span<const uint32_t> indices, std::span<const Vertex> vertices, size_t targetIndexCount, float maxError, float* outError) {
+	Simplifier s;
+
+	// compact the referenced vertices into a local range
+	std::unordered_map<uint32_t, uint32_t> localIds;
+	std::vector<uint32_t> globalIds;
+	localIds.reserve(indices.size());
+	for (uint32_t idx : indices) {
+		auto [it, inserted] = localIds.try_emplace(idx, (uint32_t)globalIds.size());
+		if (inserted) {
+			globalIds.push_back(idx);
+		}
+	}
+
+	const size_t vertexCount = globalIds.size();
+	s.positions.resize(vertexCount);
+	s.quadrics.assign(vertexCount, Quadric{});
+	s.locked.assign(vertexCount, 0);
+	s.remap.resize(vertexCount);
+	s.vertexTriangles.resize(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		s.positions[v] = glm::dvec3(vertices[globalIds[v]].position);
+		s.remap[v] = v;
+	}
+
+	// build triangles and quadrics, degenerate input triangles are dropped
+	std::unordered_map<uint64_t, uint32_t> edgeUse;
+	edgeUse.reserve(indices.size());
+	auto edgeKey = [](uint32_t a, uint32_t b) {
+		return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+	};
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		std::array<uint32_t, 3> tri = { localIds[indices[i]], localIds[indices[i + 1]], localIds[indices[i + 2]] };
+		if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+			continue;
+		}
+
+		glm::dvec3 normal = glm::cross(s.positions[tri[1]] - s.positions[tri[0]], s.positions[tri[2]] - s.positions[tri[0]]);
+		double area = glm::length(normal);
+		if (area > 0.0) {
+			normal /= area;
+			double d = -glm::dot(normal, s.positions[tri[0]]);
+			for (uint32_t v : tri) {
+				s.quadrics[v].addPlane(normal, d, area);
+			}
+		}
+
+		uint32_t t = (uint32_t)s.triangles.size();
+		s.triangles.push_back(tri);
+		for (int c = 0; c < 3; c++) {
+			s.vertexTriangles[tri[c]].push_back(t);
+			edgeUse[edgeKey(tri[c], tri[(c + 1) % 3])]++;
+		}
+	}
+	s.triangleAlive.assign(s.triangles.size(), 1);
+
+	// edges with a single triangle are open borders or uv/normal seams, moving them would tear the surface
+	for (auto& [key, count] : edgeUse) {
+		if (count == 1) {
+			s.locked[uint32_t(key >> 32)] = 1;
+			s.locked[uint32_t(key & 0xffffffff)] = 1;
+		}
+	}
+
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+	for (auto& [key, count] : edgeUse) {
+		Collapse c;
+		if (s.bestCollapse(uint32_t(key >> 32), uint32_t(key & 0xffffffff), c)) {
+			queue.push(c);
+		}
+	}
+
+	const double maxCost = double(maxError) * double(maxError);
+	size_t liveTriangles = s.triangles.size();
+	double worstCost = 0.0;
+
+	while (!queue.empty() && liveTriangles * 3 > targetIndexCount) {
+		Collapse top = queue.top();
+		queue.pop();
+
+		uint32_t src = s.find(top.src);
+		uint32_t dst = s.find(top.dst);
+		if (src == dst) {
+			continue;
+		}
+
+		// the edge moved or its quadrics grew since it was queued, re-evaluate it lazily
+		if (src != top.src || dst != top.dst) {
+			Collapse updated;
+			if (s.bestCollapse(src, dst, updated)) {
+				queue.push(updated);
+			}
+			continue;
+		}
+		double current = s.cost(src, dst);
+		if (current > top.cost * 1.0001 + 1e-12) {
+			queue.push(Collapse{ current, src, dst });
+			continue;
+		}
+		if (current > maxCost) {
+			break;
+		}
+		if (s.flips(src, dst)) {
+			continue;
+		}
+
+		s.remap[src] = dst;
+		s.quadrics[dst] += s.quadrics[src];
+		for (uint32_t t : s.vertexTriangles[src]) {
+			if (!s.triangleAlive[t]) {
+				continue;
+			}
+			auto& tri = s.triangles[t];
+			for (uint32_t& c : tri) {
+				if (c == src) {
+					c = dst;
+				}
+			}
+			if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+				s.triangleAlive[t] = 0;
+				liveTriangles--;
+			}
+			else {
+				s.vertexTriangles[dst].push_back(t);
+			}
+		}
+		s.vertexTriangles[src].clear();
+		worstCost = std::max(worstCost, current);
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(liveTriangles * 3);
+	for (size_t t = 0; t < s.triangles.size(); t++) {
+		if (!s.triangleAlive[t]) {
+			continue;
+		}
+		for (uint32_t c : s.triangles[t]) {
+			result.push_back(globalIds[c]);
+		}
+	}
+
+	if (outError) {
+		*outError = float(std::sqrt(worstCost));
+	}
+	return result;
+}
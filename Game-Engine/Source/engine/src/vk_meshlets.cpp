@@ -0,0 +1,178 @@
+#include "vk_meshlets.h"
+#include <glm/geometric.hpp>
+
+namespace {
+	void compute_bounds(GPUMeshlet& m, std::span<const uint32_t> localVertices, std::span<const uint8_t> localTriangles, std::span<const Vertex> vertices, bool coneCulling) {
+		glm::vec3 center{ 0.f };
+		for (uint32_t v : localVertices) {
+			center += vertices[v].position;
+		}
+		center /= float(localVertices.size());
+
+		float radius = 0.f;
+		for (uint32_t v : localVertices) {
+			radius = std::max(radius, glm::length(vertices[v].position - center));
+		}
+		m.sphere = glm::vec4(center, radius);
+
+		std::vector<glm::vec3> normals;
+		normals.reserve(localTriangles.size() / 3);
+		glm::vec3 axis{ 0.f };
+		for (size_t t = 0; t < localTriangles.size(); t += 3) {
+			const glm::vec3& a = vertices[localVertices[localTriangles[t]]].position;
+			const glm::vec3& b = vertices[localVertices[localTriangles[t + 1]]].position;
+			const glm::vec3& c = vertices[localVertices[localTriangles[t + 2]]].position;
+			glm::vec3 n = glm::cross(b - a, c - a);
+			float len = glm::length(n);
+			if (len > 0.f) {
+				normals.push_back(n / len);
+				axis += n / len;
+			}
+		}
+
+		m.cone = glm::vec4(0.f, 0.f, 1.f, 1.f);
+		float axisLength = glm::length(axis);
+		if (!coneCulling || axisLength <= 0.f) {
+			return;
+		}
+		axis /= axisLength;
+
+		float minDot = 1.f;
+		for (const glm::vec3& n : normals) {
+			minDot = std::min(minDot, glm::dot(axis, n));
+		}
+
+		// normals spread over more than a hemisphere can always face the camera
+		if (minDot <= 0.1f) {
+			return;
+		}
+		m.cone = glm::vec4(axis, std::sqrt(1.f - minDot * minDot));
+	}
+}
+
+uint32_t meshlet::build(std::span<uint32_t> indices, uint32_t startIndex, uint32_t count, std::span<const Vertex> vertices, bool coneCulling, MeshletData& out) {
+	const uint32_t triangleCount = count / 3;
+	std::span<uint32_t> range = indices.subspan(startIndex, triangleCount * 3);
+
+	// vertex to triangle adjacency in compressed rows
+	std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1, 0);
+	for (uint32_t idx : range) {
+		adjacencyOffsets[idx + 1]++;
+	}
+	for (size_t v = 0; v < vertices.size(); v++) {
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+	std::vector<uint32_t> adjacency(range.size());
+	{
+		std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			for (int c = 0; c < 3; c++) {
+				adjacency[cursor[range[t * 3 + c]]++] = t;
+			}
+		}
+	}
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<int32_t> localIndex(vertices.size(), -1);
+	std::vector<uint32_t> reordered;
+	reordered.reserve(range.size());
+
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint8_t> meshletTriangles;
+	uint32_t seed = 0;
+	uint32_t built = 0;
+
+	auto newVertices = [&](uint32_t t) {
+		uint32_t n = 0;
+		for (int c = 0; c < 3; c++) {
+			n += localIndex[range[t * 3 + c]] < 0 ? 1 : 0;
+		}
+		return n;
+	};
+
+	while (true) {
+		while (seed < triangleCount && emitted[seed]) {
+			seed++;
+		}
+		if (seed == triangleCount) {
+			break;
+		}
+
+		meshletVertices.clear();
+		meshletTriangles.clear();
+		uint32_t next = seed;
+
+		while (true) {
+			emitted[next] = 1;
+			for (int c = 0; c < 3; c++) {
+				uint32_t v = range[next * 3 + c];
+				if (localIndex[v] < 0) {
+					localIndex[v] = (int32_t)meshletVertices.size();
+					meshletVertices.push_back(v);
+				}
+				meshletTriangles.push_back((uint8_t)localIndex[v]);
+				reordered.push_back(v);
+			}
+
+			if (meshletTriangles.size() / 3 >= MESHLET_MAX_TRIANGLES) {
+				break;
+			}
+
+			// grow through the neighbours that add the fewest new vertices
+			uint32_t best = UINT32_MAX;
+			uint32_t bestCost = 4;
+			for (uint32_t v : meshletVertices) {
+				for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1] && bestCost > 0; a++) {
+					uint32_t t = adjacency[a];
+					if (emitted[t]) {
+						continue;
+					}
+					uint32_t cost = newVertices(t);
+					if (cost < bestCost && meshletVertices.size() + cost <= MESHLET_MAX_VERTICES) {
+						best = t;
+						bestCost = cost;
+					}
+				}
+				if (bestCost == 0) {
+					break;
+				}
+			}
+			if (best == UINT32_MAX) {
+				break;
+			}
+			next = best;
+		}
+
+		GPUMeshlet m{};
+		m.firstIndex = startIndex + (uint32_t)(reordered.size() - meshletTriangles.size());
+		m.indexCount = (uint32_t)meshletTriangles.size();
+		m.vertexOffset = (uint32_t)out.vertices.size();
+		m.triangleOffset = (uint32_t)out.triangles.size();
+		m.vertexCount = (uint32_t)meshletVertices.size();
+		m.triangleCount = (uint32_t)meshletTriangles.size() / 3;
+		compute_bounds(m, meshletVertices, meshletTriangles, vertices, coneCulling);
+
+		out.meshlets.push_back(m);
+		out.vertices.insert(out.vertices.end(), meshletVertices.begin(), meshletVertices.end());
+		out.triangles.insert(out.triangles.end(), meshletTriangles.begin(), meshletTriangles.end());
+		built++;
+
+		for (uint32_t v : meshletVertices) {
+			localIndex[v] = -1;
+		}
+	}
+
+	std::copy(reordered.begin(), reordered.end(), range.begin());
+	return built;
+}
+
+void meshlet::fixup_offsets(MeshletData& data) {
+	const uint32_t meshletBytes = (uint32_t)(data.meshlets.size() * sizeof(GPUMeshlet));
+	const uint32_t vertexBytes = (uint32_t)(data.vertices.size() * sizeof(uint32_t));
+	for (GPUMeshlet& m : data.meshlets) {
+		m.vertexOffset += meshletBytes / sizeof(uint32_t);
+		m.triangleOffset += meshletBytes + vertexBytes;
+	}
+	// the shaders read triangles as 32 bit words
+	data.triangles.resize((data.triangles.size() + 3) & ~size_t(3), 0);
+}
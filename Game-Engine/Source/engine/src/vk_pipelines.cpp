@@ -2,6 +2,7 @@
 //#define SPIRV_SHADER_FORMAT
 #include "vk_pipelines.h"
 #include <fstream>
+#include <Core/Profiler.h>
 #include <vk_initializers.h>
 #include <vk_shaderc_compiler.hpp>
 
@@ -13,6 +14,7 @@ const shdc::fs::path INCLUDE_ROOT = shdc::fs::path("Source/shaders/spirv");
 
 
 bool vkutil::load_shader_module(const char* filePath, VkDevice device, VkShaderModule* outModule) {
+	CORE_PROFILE_FUNCTION();
 
 #ifdef GLSL_SHADER_FORMAT
 	std::vector<uint32_t> spirv = shdc::compileGLSLtoSPV(shdc::fs::path(filePath), INCLUDE_ROOT);
@@ -99,6 +101,13 @@ void PipelineBuilder::setShaders(VkShaderModule vertexShader, VkShaderModule fra
 	shaderStages.push_back(vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader));
 }
 
+void PipelineBuilder::setMeshShaders(VkShaderModule taskShader, VkShaderModule meshShader, VkShaderModule fragmentShader) {
+	shaderStages.clear();
+	shaderStages.push_back(vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_TASK_BIT_EXT, taskShader));
+	shaderStages.push_back(vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_MESH_BIT_EXT, meshShader));
+	shaderStages.push_back(vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader));
+}
+
 void PipelineBuilder::setInputTopology(VkPrimitiveTopology topology) {
 	inputAssembly.topology = topology;
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
@@ -0,0 +1,320 @@
+#include "vk_render_graph.h"
+#include "vk_initializers.h"
+
+namespace {
+	bool same_desc(const RenderGraph::ImageDesc& a, const RenderGraph::ImageDesc& b) {
+		return a.format == b.format && a.extent.width == b.extent.width && a.extent.height == b.extent.height
+			&& a.usage == b.usage && a.aspect == b.aspect;
+	}
+
+	VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+void RenderGraph::PassBuilder::read(Resource resource, const ImageState& state) {
+	graph.passes[pass].accesses.push_back(Access{ resource, state, false, false });
+}
+
+void RenderGraph::PassBuilder::write(Resource resource, const ImageState& state, bool discard) {
+	graph.passes[pass].accesses.push_back(Access{ resource, state, true, discard });
+}
+
+void RenderGraph::PassBuilder::sideEffects() {
+	graph.passes[pass].sideEffects = true;
+}
+
+void RenderGraph::init(VkDevice device, VmaAllocator allocator) {
+	this->device = device;
+	this->allocator = allocator;
+}
+
+void RenderGraph::destroy(BarrierTracker& barriers) {
+	releaseTransients(nullptr, barriers, 0);
+	passes.clear();
+	resources.clear();
+	transients.clear();
+}
+
+void RenderGraph::reset() {
+	passes.clear();
+	resources.clear();
+	transients.clear();
+}
+
+RenderGraph::Resource RenderGraph::importImage(const char* name, VkImage image, VkImageView view) {
+	ResourceNode node{ name, false };
+	node.image = image;
+	node.view = view;
+	resources.push_back(node);
+	return (Resource)resources.size() - 1;
+}
+
+RenderGraph::Resource RenderGraph::createImage(const char* name, const ImageDesc& desc) {
+	ResourceNode node{ name, true, desc };
+	resources.push_back(node);
+	transients.push_back((Resource)resources.size() - 1);
+	return (Resource)resources.size() - 1;
+}
+
+void RenderGraph::setFinalState(Resource resource, const ImageState& state) {
+	resources[resource].output = true;
+	resources[resource].finalState = state;
+}
+
+void RenderGraph::addPass(const char* name, const std::function<void(PassBuilder&)>& setup, std::function<void(VkCommandBuffer)> execute) {
+	passes.push_back(Pass{ name, {}, std::move(execute) });
+	PassBuilder builder{ *this, (uint32_t)passes.size() - 1 };
+	setup(builder);
+}
+
+size_t RenderGraph::culledPassCount() const {
+	return std::count_if(passes.begin(), passes.end(), [](const Pass& p) { return p.culled; });
+}
+
+void RenderGraph::compile(TypedDeletionQueue& deletion, BarrierTracker& barriers, uint64_t safeAfter) {
+	cullPasses();
+	computeLifetimes();
+	if (!transientsMatch()) {
+		allocateTransients(deletion, barriers, safeAfter);
+	}
+
+	for (size_t i = 0; i < transients.size(); i++) {
+		ResourceNode& node = resources[transients[i]];
+		const TransientImage& t = transientImages[i];
+		node.image = t.image;
+		node.view = t.view;
+		node.memoryOffset = t.offset;
+		node.aliases.clear();
+		for (uint32_t a : t.aliases) {
+			node.aliases.push_back(transients[a]);
+		}
+	}
+}
+
+void RenderGraph::cullPasses() {
+	// walking backwards from the outputs, a pass survives when something later needs one of the images it writes
+	std::vector<bool> needed(resources.size());
+	for (size_t r = 0; r < resources.size(); r++) {
+		needed[r] = resources[r].output;
+	}
+
+	for (size_t i = passes.size(); i-- > 0;) {
+		Pass& pass = passes[i];
+		bool alive = pass.sideEffects;
+		for (const Access& a : pass.accesses) {
+			alive |= a.write && needed[a.resource];
+		}
+		pass.culled = !alive;
+		if (!alive) {
+			continue;
+		}
+
+		// a discarding write ends the need for earlier contents, reads and partial writes extend it
+		for (const Access& a : pass.accesses) {
+			if (a.write && a.discard) {
+				needed[a.resource] = false;
+			}
+		}
+		for (const Access& a : pass.accesses) {
+			if (!a.write || !a.discard) {
+				needed[a.resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::computeLifetimes() {
+	for (uint32_t i = 0; i < passes.size(); i++) {
+		if (passes[i].culled) {
+			continue;
+		}
+		for (const Access& a : passes[i].accesses) {
+			ResourceNode& node = resources[a.resource];
+			node.firstPass = std::min(node.firstPass, i);
+			node.lastPass = std::max(node.lastPass, i);
+		}
+	}
+}
+
+bool RenderGraph::transientsMatch() const {
+	if (transients.size() != transientImages.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < transients.size(); i++) {
+		const ResourceNode& node = resources[transients[i]];
+		const TransientImage& t = transientImages[i];
+		if (!same_desc(node.desc, t.desc) || node.firstPass != t.firstPass || node.lastPass != t.lastPass) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void RenderGraph::allocateTransients(TypedDeletionQueue& deletion, BarrierTracker& barriers, uint64_t safeAfter) {
+	releaseTransients(&deletion, barriers, safeAfter);
+
+	transientImages.resize(transients.size());
+	std::vector<VkMemoryRequirements> requirements(transients.size());
+	std::vector<uint32_t> used;
+	uint32_t memoryTypeBits = ~0u;
+	VkDeviceSize alignment = 1;
+	unaliasedMemorySize = 0;
+
+	for (uint32_t i = 0; i < transients.size(); i++) {
+		const ResourceNode& node = resources[transients[i]];
+		TransientImage& t = transientImages[i];
+		t = TransientImage{ node.desc, node.firstPass, node.lastPass, VK_NULL_HANDLE, VK_NULL_HANDLE, 0, VK_NULL_HANDLE };
+		// declared but only used by culled passes
+		if (node.firstPass == UINT32_MAX) {
+			continue;
+		}
+
+		VkImageCreateInfo info = vkinit::image_create_info(node.desc.format, node.desc.usage, VkExtent3D{ node.desc.extent.width, node.desc.extent.height, 1 });
+		VK_CHECK(vkCreateImage(device, &info, nullptr, &t.image));
+		vkGetImageMemoryRequirements(device, t.image, &requirements[i]);
+
+		memoryTypeBits &= requirements[i].memoryTypeBits;
+		alignment = std::max(alignment, requirements[i].alignment);
+		unaliasedMemorySize += requirements[i].size;
+		used.push_back(i);
+	}
+
+	// largest first, each image takes the lowest offset not overlapping an image alive at the same time
+	std::sort(used.begin(), used.end(), [&](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+	std::vector<uint32_t> placed;
+	transientMemorySize = 0;
+	for (uint32_t i : used) {
+		TransientImage& t = transientImages[i];
+		VkDeviceSize offset = 0;
+		bool moved = true;
+		while (moved) {
+			moved = false;
+			for (uint32_t p : placed) {
+				const TransientImage& o = transientImages[p];
+				bool livesTogether = t.firstPass <= o.lastPass && o.firstPass <= t.lastPass;
+				bool overlaps = offset < o.offset + requirements[p].size && o.offset < offset + requirements[i].size;
+				if (livesTogether && overlaps) {
+					offset = align_up(o.offset + requirements[p].size, requirements[i].alignment);
+					moved = true;
+				}
+			}
+		}
+		t.offset = offset;
+		transientMemorySize = std::max(transientMemorySize, offset + requirements[i].size);
+		placed.push_back(i);
+	}
+
+	VmaAllocationCreateInfo allocInfo = {};
+	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	allocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (!used.empty() && memoryTypeBits != 0) {
+		VkMemoryRequirements shared{ transientMemorySize, alignment, memoryTypeBits };
+		VK_CHECK(vmaAllocateMemory(allocator, &shared, &allocInfo, &sharedAllocation, nullptr));
+		for (uint32_t i : used) {
+			VK_CHECK(vmaBindImageMemory2(allocator, sharedAllocation, transientImages[i].offset, transientImages[i].image, nullptr));
+		}
+
+		for (uint32_t i : used) {
+			for (uint32_t j : used) {
+				const TransientImage& a = transientImages[i];
+				const TransientImage& b = transientImages[j];
+				if (i != j && a.offset < b.offset + requirements[j].size && b.offset < a.offset + requirements[i].size) {
+					transientImages[i].aliases.push_back(j);
+				}
+			}
+		}
+	}
+	else {
+		// no memory type suits all of them, every image gets memory of its own
+		transientMemorySize = unaliasedMemorySize;
+		for (uint32_t i : used) {
+			TransientImage& t = transientImages[i];
+			t.offset = 0;
+			VK_CHECK(vmaAllocateMemoryForImage(allocator, t.image, &allocInfo, &t.allocation, nullptr));
+			VK_CHECK(vmaBindImageMemory(allocator, t.allocation, t.image));
+		}
+	}
+
+	for (uint32_t i : used) {
+		TransientImage& t = transientImages[i];
+		VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(t.desc.format, t.image, t.desc.aspect);
+		VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &t.view));
+	}
+}
+
+void RenderGraph::releaseTransients(TypedDeletionQueue* deletion, BarrierTracker& barriers, uint64_t safeAfter) {
+	for (const TransientImage& t : transientImages) {
+		if (t.image == VK_NULL_HANDLE) {
+			continue;
+		}
+		// a later image may get the same handle and must not inherit this one's layout
+		barriers.forget(t.image);
+		if (deletion != nullptr) {
+			deletion->destroyImageView(t.view, safeAfter);
+			deletion->destroyImage(t.image, safeAfter);
+			deletion->freeMemory(t.allocation, safeAfter);
+		}
+		else {
+			vkDestroyImageView(device, t.view, nullptr);
+			vkDestroyImage(device, t.image, nullptr);
+			if (t.allocation != VK_NULL_HANDLE) {
+				vmaFreeMemory(allocator, t.allocation);
+			}
+		}
+	}
+	if (sharedAllocation != VK_NULL_HANDLE) {
+		if (deletion != nullptr) {
+			deletion->freeMemory(sharedAllocation, safeAfter);
+		}
+		else {
+			vmaFreeMemory(allocator, sharedAllocation);
+		}
+	}
+
+	transientImages.clear();
+	sharedAllocation = VK_NULL_HANDLE;
+	transientMemorySize = 0;
+	unaliasedMemorySize = 0;
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd, BarrierTracker& barriers, GpuProfiler* profiler) {
+	for (uint32_t i = 0; i < passes.size(); i++) {
+		const Pass& pass = passes[i];
+		if (pass.culled) {
+			continue;
+		}
+		uint32_t scope = profiler ? profiler->begin(cmd, pass.name) : UINT32_MAX;
+
+		for (const Access& a : pass.accesses) {
+			const ResourceNode& node = resources[a.resource];
+			bool discard = a.discard;
+			if (node.transient && node.firstPass == i) {
+				// the memory held another image since the last use of this one, whose accesses must finish first
+				ImageState previous = barriers.state(node.image);
+				for (Resource alias : node.aliases) {
+					const ImageState& s = barriers.state(resources[alias].image);
+					previous.stages |= s.stages;
+					previous.access |= s.access;
+				}
+				barriers.setState(node.image, ImageState{ VK_IMAGE_LAYOUT_UNDEFINED, previous.stages, previous.access }, node.desc.aspect);
+				discard = true;
+			}
+			barriers.transition(node.image, a.state, discard);
+		}
+		barriers.flush(cmd);
+
+		pass.execute(cmd);
+		if (profiler) {
+			profiler->end(cmd, scope);
+		}
+	}
+
+	for (const ResourceNode& node : resources) {
+		if (node.output) {
+			barriers.transition(node.image, node.finalState);
+		}
+	}
+	barriers.flush(cmd);
+}
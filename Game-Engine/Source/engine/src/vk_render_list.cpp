@@ -0,0 +1,141 @@
+#include "vk_render_list.h"
+
+namespace {
+	// a refit tree this much worse than a fresh build is rebuilt
+	constexpr float BVH_REBUILD_DEGRADATION = 2.f;
+}
+
+RenderHandle RenderList::add(const RenderObject& object, bool transparent) {
+	uint32_t slotIndex = freeSlot;
+	if (slotIndex != UINT32_MAX) {
+		freeSlot = slots[slotIndex].index;
+	}
+	else {
+		slotIndex = (uint32_t)slots.size();
+		slots.emplace_back();
+	}
+
+	Slot& slot = slots[slotIndex];
+	slot.transparent = transparent;
+	if (slot.transparent) {
+		slot.index = (uint32_t)transparentObjects.size();
+		transparentObjects.push_back(object);
+		transparentSlots.push_back(slotIndex);
+	}
+	else {
+		slot.index = (uint32_t)opaqueObjects.size();
+		opaqueObjects.push_back(object);
+		opaqueSlots.push_back(slotIndex);
+		bounds.resize(opaqueObjects.size());
+		bounds.set(slot.index, object.bounds, object.transform);
+		bvhStale = true;
+	}
+
+	return RenderHandle{ slotIndex, slot.generation };
+}
+
+void RenderList::add(const DrawContext& ctx, std::vector<RenderHandle>* handles) {
+	for (const RenderObject& r : ctx.OpaqueSurfaces) {
+		RenderHandle h = add(r, false);
+		if (handles) {
+			handles->push_back(h);
+		}
+	}
+	for (const RenderObject& r : ctx.TransparentSurfaces) {
+		RenderHandle h = add(r, true);
+		if (handles) {
+			handles->push_back(h);
+		}
+	}
+}
+
+void RenderList::remove(RenderHandle handle) {
+	if (!contains(handle)) {
+		return;
+	}
+
+	Slot& slot = slots[handle.slot];
+	if (slot.transparent) {
+		transparentObjects.erase(transparentObjects.begin() + slot.index);
+		transparentSlots.erase(transparentSlots.begin() + slot.index);
+		for (uint32_t i = slot.index; i < transparentSlots.size(); i++) {
+			slots[transparentSlots[i]].index = i;
+		}
+	}
+	else {
+		// the last object fills the gap, opaque draws are sorted every frame so their order does not matter
+		const uint32_t last = (uint32_t)opaqueObjects.size() - 1;
+		if (slot.index != last) {
+			opaqueObjects[slot.index] = opaqueObjects[last];
+			opaqueSlots[slot.index] = opaqueSlots[last];
+			slots[opaqueSlots[slot.index]].index = slot.index;
+			bounds.set(slot.index, opaqueObjects[slot.index].bounds, opaqueObjects[slot.index].transform);
+		}
+		opaqueObjects.pop_back();
+		opaqueSlots.pop_back();
+		bounds.resize(opaqueObjects.size());
+		bvhStale = true;
+	}
+
+	slot.generation++;
+	slot.index = freeSlot;
+	freeSlot = handle.slot;
+}
+
+void RenderList::setTransform(RenderHandle handle, const glm::mat4& transform) {
+	if (!contains(handle)) {
+		return;
+	}
+
+	const Slot& slot = slots[handle.slot];
+	if (slot.transparent) {
+		transparentObjects[slot.index].transform = transform;
+	}
+	else {
+		RenderObject& object = opaqueObjects[slot.index];
+		object.transform = transform;
+		bounds.set(slot.index, object.bounds, transform);
+		if (!bvhStale) {
+			movedOpaque.push_back(slot.index);
+		}
+	}
+}
+
+bool RenderList::contains(RenderHandle handle) const {
+	return handle.slot < slots.size() && slots[handle.slot].generation == handle.generation;
+}
+
+void RenderList::clear() {
+	// generations survive so handles from before the clear stay invalid
+	freeSlot = UINT32_MAX;
+	for (uint32_t i = (uint32_t)slots.size(); i-- > 0;) {
+		slots[i].generation++;
+		slots[i].index = freeSlot;
+		freeSlot = i;
+	}
+	opaqueObjects.clear();
+	opaqueSlots.clear();
+	transparentObjects.clear();
+	transparentSlots.clear();
+	bounds.resize(0);
+	bvhStale = true;
+}
+
+const BVH& RenderList::opaqueBvh() {
+	if (!bvhStale && !movedOpaque.empty()) {
+		// walking up from every moved leaf only pays off while few objects moved
+		if (movedOpaque.size() * 8 > opaqueObjects.size()) {
+			bvh.refit(bounds);
+		}
+		else {
+			bvh.refit(bounds, movedOpaque);
+		}
+		bvhStale = bvh.degradation() > BVH_REBUILD_DEGRADATION;
+	}
+	if (bvhStale) {
+		bvh.build(bounds);
+		bvhStale = false;
+	}
+	movedOpaque.clear();
+	return bvh;
+}
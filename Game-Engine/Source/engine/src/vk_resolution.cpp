@@ -0,0 +1,51 @@
+#include "vk_resolution.h"
+#include <cmath>
+
+namespace {
+	// weight of the newest sample in the moving average, smooths out single slow frames
+	constexpr float SMOOTHING = 0.2f;
+}
+
+void ResolutionController::init(uint32_t latencyFrames) {
+	latency = latencyFrames;
+	reset(maxScale);
+}
+
+void ResolutionController::reset(float scale) {
+	current = std::clamp(scale, minScale, maxScale);
+	smoothed = 0.f;
+	cooldown = latency;
+}
+
+float ResolutionController::update(float gpuMs) {
+	if (std::isnan(gpuMs) || gpuMs <= 0.f) {
+		return current;
+	}
+	// timings still in flight were rendered at the previous scale
+	if (cooldown > 0) {
+		cooldown--;
+		return current;
+	}
+	smoothed = smoothed > 0.f ? smoothed + (gpuMs - smoothed) * SMOOTHING : gpuMs;
+
+	const bool overBudget = smoothed > targetMs;
+	const bool underBudget = smoothed < targetMs * (1.f - HEADROOM);
+	if (!overBudget && !underBudget) {
+		return current;
+	}
+
+	// aim for the middle of the dead band, so the next measurement lands inside it
+	const float goalMs = targetMs * (1.f - HEADROOM * 0.5f);
+	float next = current * std::sqrt(goalMs / smoothed);
+	next = std::clamp(next, current - MAX_STEP, current + MAX_STEP);
+	next = std::clamp(next, minScale, maxScale);
+	if (std::abs(next - current) < MIN_STEP && next != minScale && next != maxScale) {
+		return current;
+	}
+	if (next != current) {
+		current = next;
+		smoothed = 0.f;
+		cooldown = latency;
+	}
+	return current;
+}
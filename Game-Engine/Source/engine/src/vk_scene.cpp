@@ -0,0 +1,176 @@
+#include "vk_scene.h"
+#include "vk_loader.h"
+#include <Core/ThreadPool.h>
+#include <cassert>
+
+namespace {
+	// nodes per worker task when a level is split across the pool
+	constexpr size_t TRANSFORM_GRAIN = 2048;
+}
+
+uint32_t SceneGraph::addNode(uint32_t parent, const glm::mat4& localTransform, MeshHandle mesh) {
+	const uint32_t index = (uint32_t)parents.size();
+	assert(parent == NO_PARENT || parent < index);
+	assert(renderList == nullptr && "nodes cannot be added while registered with a render list");
+
+	// a new level starts with the first child of a node on the previous last level
+	uint32_t level = 0;
+	if (parent != NO_PARENT) {
+		level = (uint32_t)(std::upper_bound(levelStarts.begin(), levelStarts.end(), parent) - levelStarts.begin());
+	}
+	if (level == levelStarts.size()) {
+		levelStarts.push_back(index);
+	}
+	assert(level + 1 == levelStarts.size() && "scene graph nodes must be added in breadth first order");
+
+	parents.push_back(parent);
+	localTransforms.push_back(localTransform);
+	worldTransforms.push_back(localTransform);
+	dirty.push_back(1);
+	anyDirty = true;
+
+	if (mesh) {
+		meshNodes.push_back(index);
+	}
+	meshes.push_back(mesh);
+	return index;
+}
+
+void SceneGraph::clear() {
+	removeFromRenderList();
+	parents.clear();
+	localTransforms.clear();
+	worldTransforms.clear();
+	dirty.clear();
+	levelStarts.clear();
+	meshNodes.clear();
+	meshes.clear();
+	anyDirty = false;
+}
+
+void SceneGraph::setLocalTransform(uint32_t node, const glm::mat4& localTransform) {
+	localTransforms[node] = localTransform;
+	dirty[node] = 1;
+	anyDirty = true;
+}
+
+void SceneGraph::updateTransforms(Core::ThreadPool* pool) {
+	if (!anyDirty) {
+		return;
+	}
+
+	auto updateRange = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const uint32_t p = parents[i];
+			if (p == NO_PARENT) {
+				if (dirty[i]) {
+					worldTransforms[i] = localTransforms[i];
+				}
+				continue;
+			}
+			// parents sit on the previous level, which is already final
+			if (dirty[p]) {
+				dirty[i] = 1;
+			}
+			if (dirty[i]) {
+				worldTransforms[i] = worldTransforms[p] * localTransforms[i];
+			}
+		}
+	};
+
+	for (size_t level = 0; level < levelStarts.size(); level++) {
+		const size_t begin = levelStarts[level];
+		const size_t end = level + 1 < levelStarts.size() ? levelStarts[level + 1] : parents.size();
+		if (pool != nullptr && end - begin > TRANSFORM_GRAIN) {
+			pool->ParallelFor(end - begin, TRANSFORM_GRAIN, [&](size_t b, size_t e) {
+				updateRange(begin + b, begin + e);
+				});
+		}
+		else {
+			updateRange(begin, end);
+		}
+	}
+
+	if (renderList != nullptr) {
+		for (size_t k = 0; k < meshNodes.size(); k++) {
+			const uint32_t node = meshNodes[k];
+			if (!dirty[node]) {
+				continue;
+			}
+			const glm::mat4 transform = renderTransform * worldTransforms[node];
+			for (uint32_t h = renderRanges[k]; h < renderRanges[k + 1]; h++) {
+				renderList->setTransform(renderHandles[h], transform);
+			}
+		}
+	}
+
+	std::fill(dirty.begin(), dirty.end(), 0);
+	anyDirty = false;
+}
+
+void SceneGraph::draw(const AssetPools& assets, const glm::mat4& topMatrix, DrawContext& ctx) const {
+	for (uint32_t node : meshNodes) {
+		addMeshDraws(assets.meshes.get(meshes[node]), assets, topMatrix * worldTransforms[node], ctx);
+	}
+}
+
+void SceneGraph::addToRenderList(RenderList& list, const AssetPools& assets, const glm::mat4& topMatrix) {
+	removeFromRenderList();
+	updateTransforms();
+
+	renderList = &list;
+	renderTransform = topMatrix;
+	renderRanges.reserve(meshNodes.size() + 1);
+	renderRanges.push_back(0);
+
+	DrawContext ctx;
+	for (uint32_t node : meshNodes) {
+		ctx.OpaqueSurfaces.clear();
+		ctx.TransparentSurfaces.clear();
+		addMeshDraws(assets.meshes.get(meshes[node]), assets, topMatrix * worldTransforms[node], ctx);
+		list.add(ctx, &renderHandles);
+		renderRanges.push_back((uint32_t)renderHandles.size());
+	}
+}
+
+void SceneGraph::removeFromRenderList() {
+	if (renderList == nullptr) {
+		return;
+	}
+	for (RenderHandle h : renderHandles) {
+		renderList->remove(h);
+	}
+	renderHandles.clear();
+	renderRanges.clear();
+	renderList = nullptr;
+}
+
+void addMeshDraws(const MeshAsset& mesh, const AssetPools& assets, const glm::mat4& transform, DrawContext& ctx) {
+	for (uint32_t i = 0; i < mesh.surfaces.size(); i++) {
+		const GeoSurface& s = mesh.surfaces[i];
+		RenderObject obj;
+		obj.indexCount = s.count;
+		obj.firstIndex = s.startIndex;
+		obj.indexBuffer = mesh.meshBuffers.indexBuffer;
+		obj.indexType = mesh.meshBuffers.indexType;
+		obj.baseIndex = mesh.meshBuffers.firstIndex;
+		obj.vertexOffset = mesh.meshBuffers.vertexOffset;
+		obj.geometryId = (mesh.meshBuffers.id << 6) | (i & 0x3f);
+		obj.material = s.material;
+		obj.bounds = s.bounds;
+		obj.transform = transform;
+		obj.vertexBufferAddress = mesh.meshBuffers.vertexBufferAddress;
+		obj.lods = s.lods.data();
+		obj.lodCount = s.lodCount;
+		obj.meshletCount = s.meshletCount;
+		obj.meshletBufferAddress = s.meshletCount > 0 ? mesh.meshBuffers.meshletBufferAddress + s.meshletOffset * sizeof(GPUMeshlet) : 0;
+		obj.meshletDataAddress = mesh.meshBuffers.meshletBufferAddress;
+
+		if (assets.materials.get(s.material).passType == MaterialPass::TRASNPARENT) {
+			ctx.TransparentSurfaces.push_back(obj);
+		}
+		else {
+			ctx.OpaqueSurfaces.push_back(obj);
+		}
+	}
+}
@@ -0,0 +1,151 @@
+#include "vk_scene_loader.h"
+#include "vk_engine.h"
+#include "vk_initializers.h"
+#include <thread>
+
+void AsyncSceneLoader::init(VulkanEngine* engine) {
+	this->engine = engine;
+
+	VkCommandPoolCreateInfo commandPoolInfo = vkinit::command_pool_create_info(engine->graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+	VK_CHECK(vkCreateCommandPool(engine->driver, &commandPoolInfo, nullptr, &commandPool));
+
+	VkSemaphoreTypeCreateInfo timelineInfo = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+	timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineInfo.initialValue = 0;
+	VkSemaphoreCreateInfo semaphoreInfo = vkinit::semaphore_create_info();
+	semaphoreInfo.pNext = &timelineInfo;
+	VK_CHECK(vkCreateSemaphore(engine->driver, &semaphoreInfo, nullptr, &timeline));
+}
+
+void AsyncSceneLoader::destroy() {
+	if (!engine) {
+		return;
+	}
+	// loads check stopping whenever they resume and return, a partly uploaded scene releases what it created through
+	// its LoadedGLTF. Parsing cannot be interrupted, so this waits for it
+	stopping = true;
+	finish();
+	loads.clear();
+
+	for (std::unique_ptr<Slice>& slice : slices) {
+		for (const AllocatedBuffer& buffer : slice->staging) {
+			engine->destroyBuffer(buffer);
+		}
+	}
+	slices.clear();
+
+	vkDestroySemaphore(engine->driver, timeline, nullptr);
+	vkDestroyCommandPool(engine->driver, commandPool, nullptr);
+	engine = nullptr;
+}
+
+void AsyncSceneLoader::load(const std::string& name, const std::filesystem::path& path) {
+	std::erase_if(loads, [](const Core::Task<>& load) { return load.IsDone(); });
+
+	loads.push_back(loadScene(name, path));
+	loads.back().Start();
+}
+
+void AsyncSceneLoader::finish() {
+	while (pendingCount() > 0) {
+		engine->completions.poll();
+		if (pendingCount() == 0) {
+			break;
+		}
+
+		uint64_t completed;
+		VK_CHECK(vkGetSemaphoreCounterValue(engine->driver, timeline, &completed));
+		if (completed < submitted) {
+			VkSemaphoreWaitInfo waitInfo = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &timeline;
+			waitInfo.pValues = &submitted;
+			VK_CHECK(vkWaitSemaphores(engine->driver, &waitInfo, UINT64_MAX));
+		}
+		else {
+			// still parsing
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+size_t AsyncSceneLoader::pendingCount() const {
+	return std::count_if(loads.begin(), loads.end(), [](const Core::Task<>& load) { return !load.IsDone(); });
+}
+
+Core::Task<> AsyncSceneLoader::loadScene(std::string name, std::filesystem::path path) {
+	auto start = std::chrono::steady_clock::now();
+
+	co_await Core::ResumeOn(engine->threadPool);
+	std::optional<GLTFSceneData> data = parse_gltf(path);
+	// the upload records commands, so it continues on the render thread
+	co_await engine->completions.nextFrame();
+
+	if (!data.has_value()) {
+		fmt::print("[GLTF ERROR] could not load scene {}\n", name);
+		co_return;
+	}
+
+	// images first, then the materials referencing them, then the meshes referencing those
+	GLTFUpload upload(engine, std::move(*data));
+	bool uploaded = false;
+	while (!uploaded && !stopping) {
+		uploaded = co_await uploadSlice(upload);
+	}
+	if (!uploaded) {
+		co_return;
+	}
+
+	std::shared_ptr<LoadedGLTF> scene = upload.scene();
+	scene->graph.addToRenderList(engine->renderList, engine->assets, glm::mat4{ 1.f });
+	engine->loadedScenes[name] = scene;
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+	fmt::print("[CONSOLE INFO]: scene {} loaded in {:.1f} ms\n", name, elapsed.count() / 1000.f);
+}
+
+Core::Task<bool> AsyncSceneLoader::uploadSlice(GLTFUpload& upload) {
+	Slice& slice = acquireSlice();
+
+	VK_CHECK(vkResetCommandBuffer(slice.cmd, 0));
+	VkCommandBufferBeginInfo beginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	VK_CHECK(vkBeginCommandBuffer(slice.cmd, &beginInfo));
+
+	bool uploaded = upload.step(slice.cmd, slice.staging, SLICE_BYTES);
+
+	VK_CHECK(vkEndCommandBuffer(slice.cmd));
+
+	VkCommandBufferSubmitInfo cmdInfo = vkinit::command_buffer_submit_info(slice.cmd);
+	VkSemaphoreSubmitInfo signalInfo = vkinit::semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, timeline);
+	signalInfo.value = ++submitted;
+	VkSubmitInfo2 submit = vkinit::submit_info(&cmdInfo, &signalInfo, nullptr);
+	VK_CHECK(vkQueueSubmit2(engine->graphicsQueue, 1, &submit, VK_NULL_HANDLE));
+
+	co_await engine->completions.timeline(timeline, signalInfo.value);
+
+	releaseSlice(slice);
+	co_return uploaded;
+}
+
+AsyncSceneLoader::Slice& AsyncSceneLoader::acquireSlice() {
+	for (std::unique_ptr<Slice>& slice : slices) {
+		if (!slice->busy) {
+			slice->busy = true;
+			return *slice;
+		}
+	}
+
+	Slice& slice = *slices.emplace_back(std::make_unique<Slice>());
+	VkCommandBufferAllocateInfo allocInfo = vkinit::command_buffer_allocate_info(commandPool, 1);
+	VK_CHECK(vkAllocateCommandBuffers(engine->driver, &allocInfo, &slice.cmd));
+	slice.busy = true;
+	return slice;
+}
+
+void AsyncSceneLoader::releaseSlice(Slice& slice) {
+	for (const AllocatedBuffer& buffer : slice.staging) {
+		engine->destroyBuffer(buffer);
+	}
+	slice.staging.clear();
+	slice.busy = false;
+}
@@ -0,0 +1,58 @@
+#include "vk_sort.h"
+#include <bit>
+
+uint64_t drawsort::make_key(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t indexType, uint32_t geometry, float viewDepth) {
+	// the bits of a positive float grow with its value, keeping the exponent and top mantissa bits quantises
+	// depth logarithmically: relative precision stays the same near and far
+	uint32_t depthBits = viewDepth > 0.f ? std::bit_cast<uint32_t>(viewDepth) : 0;
+	uint64_t depth = (depthBits >> 14) & 0x1ffff;
+
+	return (uint64_t(pass & 0x1) << 63)
+		| (uint64_t(pipeline & 0x7) << 60)
+		| (uint64_t(material & 0x3fff) << 46)
+		| (uint64_t(indexType & 0x1) << 45)
+		| (uint64_t(geometry & 0xfffffff) << 17)
+		| depth;
+}
+
+void drawsort::radix_sort(std::vector<Item>& items, std::vector<Item>& scratch) {
+	const size_t count = items.size();
+	if (count < 2) {
+		return;
+	}
+	scratch.resize(count);
+
+	// all 8 histograms in one read of the keys
+	std::array<std::array<uint32_t, 256>, 8> histograms{};
+	for (const Item& item : items) {
+		for (int d = 0; d < 8; d++) {
+			histograms[d][(item.key >> (d * 8)) & 0xff]++;
+		}
+	}
+
+	Item* src = items.data();
+	Item* dst = scratch.data();
+	for (int d = 0; d < 8; d++) {
+		std::array<uint32_t, 256>& histogram = histograms[d];
+		const uint32_t firstDigit = (src[0].key >> (d * 8)) & 0xff;
+		if (histogram[firstDigit] == count) {
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t& bucket : histogram) {
+			uint32_t size = bucket;
+			bucket = offset;
+			offset += size;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			dst[histogram[(src[i].key >> (d * 8)) & 0xff]++] = src[i];
+		}
+		std::swap(src, dst);
+	}
+
+	if (src != items.data()) {
+		items.swap(scratch);
+	}
+}
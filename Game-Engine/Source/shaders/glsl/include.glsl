@@ -5,6 +5,8 @@ layout(set = 0, binding = 0) uniform SceneData {
     vec4 ambientColor;
     vec4 sunDirection; // w component unused
     vec4 sunColor;
+    vec4 frustumPlanes[6]; // world space, xyz normal pointing inwards, w distance
+    vec4 cameraPosition; // w component unused
 } sceneData;
 
 layout (set = 1, binding = 0) uniform GLTFMaterialData {
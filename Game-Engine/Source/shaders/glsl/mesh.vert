@@ -21,16 +21,22 @@ layout (buffer_reference, std430) readonly buffer VertexBuffer {
     Vertex vertices[];
 };
 
+layout (buffer_reference, std430) readonly buffer InstanceBuffer {
+    mat4 transforms[];
+};
+
 layout (push_constant) uniform PushConstants {
     mat4 renderMatrix;
     VertexBuffer vertexBuffer;
+    InstanceBuffer instanceBuffer;
 } pushConstants;
 
 void main() {
     Vertex v = pushConstants.vertexBuffer.vertices[gl_VertexIndex];
+    mat4 renderMatrix = pushConstants.instanceBuffer.transforms[gl_InstanceIndex];
     vec4 position = vec4(v.position, 1.0);
-    gl_Position = sceneData.viewproj * pushConstants.renderMatrix * position;
-    outNormal = (pushConstants.renderMatrix * vec4(v.normal, 0.0)).xyz;
+    gl_Position = sceneData.viewproj * renderMatrix * position;
+    outNormal = (renderMatrix * vec4(v.normal, 0.0)).xyz;
     outColor = v.color.xyz * materialData.colorFactors.rgb;
     outUV = vec2(v.uv_x, v.uv_y);
 }
\ No newline at end of file
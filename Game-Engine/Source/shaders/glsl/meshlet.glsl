@@ -0,0 +1,62 @@
+struct Vertex {
+    vec3 position;
+    float uv_x;
+    vec3 normal;
+    float uv_y;
+    vec4 color;
+};
+
+struct Meshlet {
+    vec4 sphere; // object space center, radius
+    vec4 cone; // normal cone axis, sine of its half angle
+    uint firstIndex;
+    uint indexCount;
+    uint vertexOffset; // in words from the start of the meshlet buffer
+    uint triangleOffset; // in bytes from the start of the meshlet buffer
+    uint vertexCount;
+    uint triangleCount;
+    uint padding0;
+    uint padding1;
+};
+
+layout (buffer_reference, std430) readonly buffer VertexBuffer {
+    Vertex vertices[];
+};
+
+layout (buffer_reference, std430) readonly buffer MeshletBuffer {
+    Meshlet meshlets[];
+};
+
+layout (buffer_reference, std430) readonly buffer MeshletWords {
+    uint words[];
+};
+
+bool meshletVisible(Meshlet m, mat4 transform, vec4 planes[6], vec3 cameraPosition) {
+    float scale = max(max(length(transform[0].xyz), length(transform[1].xyz)), length(transform[2].xyz));
+    vec3 center = (transform * vec4(m.sphere.xyz, 1.0)).xyz;
+    float radius = m.sphere.w * scale;
+
+    for (int i = 0; i < 6; i++) {
+        if (dot(planes[i].xyz, center) + planes[i].w < -radius) {
+            return false;
+        }
+    }
+
+    // the cone only bounds the normals under rotation, uniform scale and translation. Non-uniform scale or shear
+    // widens it beyond cone.w and mirroring flips the facing, so such clusters are kept
+    mat3 linear = mat3(transform);
+    vec3 scales = vec3(dot(linear[0], linear[0]), dot(linear[1], linear[1]), dot(linear[2], linear[2]));
+    float tolerance = 1e-3 * scales.x;
+    bool conformal = abs(scales.x - scales.y) < tolerance && abs(scales.x - scales.z) < tolerance
+        && abs(dot(linear[0], linear[1])) < tolerance && abs(dot(linear[0], linear[2])) < tolerance
+        && abs(dot(linear[1], linear[2])) < tolerance;
+    if (!conformal || determinant(linear) <= 0.0) {
+        return true;
+    }
+
+    // every triangle of the cluster faces away from the camera. Normals transform by the inverse transpose, which
+    // for a conformal matrix is the matrix itself divided by the squared scale, so only its direction is needed
+    vec3 axis = normalize(linear * m.cone.xyz);
+    vec3 view = center - cameraPosition;
+    return dot(view, axis) < m.cone.w * length(view) + radius;
+}
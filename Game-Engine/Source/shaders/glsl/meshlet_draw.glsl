@@ -0,0 +1,15 @@
+const uint MESHLET_TASK_GROUP_SIZE = 32;
+
+struct MeshletPayload {
+    uint meshletIndices[MESHLET_TASK_GROUP_SIZE];
+};
+
+// extends the mesh.vert push constants, the leading members must stay identical
+layout (push_constant) uniform PushConstants {
+    mat4 renderMatrix;
+    VertexBuffer vertexBuffer;
+    uvec2 instanceBuffer; // unused by the meshlet path
+    MeshletBuffer meshletBuffer; // first meshlet of the surface
+    MeshletWords meshletData; // start of the mesh meshlet buffer
+    uint meshletCount;
+} pushConstants;